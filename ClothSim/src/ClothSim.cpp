@@ -73,7 +73,7 @@ static const float k_targetFPS(60.0f);
 static const float k_targetDT(1.0f / k_targetFPS);
 static const float k_updateDT(1.0f / 60.0f); // Simulation time for each frame
 
-static const int k_rldTexSize(1024);
+static const ivec2 k_rldTexSize(1024, 1024);
 static const int k_rldSliceCount(100);
 
 static const int k_minCompSize(128);
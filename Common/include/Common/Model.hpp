@@ -51,6 +51,8 @@ class HardMesh : public Mesh {
 
     const std::vector<u32> & indices() const { return m_indices; }
 
+    u32 vertexBuffer() const { return m_vertexBuffer; }
+
     private:
 
     std::vector<Vertex> m_vertices;
@@ -162,7 +164,8 @@ class Model {
 
     public:
 
-    static unq<Model> load(const std::string & filename);
+    // If `uploadMeshes` is false, the meshes are not sent to the GPU, so no OpenGL context is needed
+    static unq<Model> load(const std::string & filename, bool uploadMeshes = true);
 
     private:
 
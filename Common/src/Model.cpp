@@ -231,7 +231,7 @@ static unq<Model> loadGRL(const std::string & filename) {
     return unq<Model>(new Model(move(subModels)));
 }
 
-unq<Model> Model::load(const std::string & filename) {
+unq<Model> Model::load(const std::string & filename, bool uploadMeshes) {
     std::string ext(util::getExtension(filename));
 
     unq<Model> model;
@@ -250,6 +250,10 @@ unq<Model> Model::load(const std::string & filename) {
         return {};
     }
 
+    if (!uploadMeshes) {
+        return model;
+    }
+
     for (SubModel & subModel : model->m_subModels) {
         if (!subModel.m_mesh->load()) {
             std::cerr << "Failed to load sub model: " << subModel.m_name << std::endl;
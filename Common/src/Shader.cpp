@@ -239,6 +239,47 @@ static u32 createProgram(
     return createProgram(newVertSrc, newTescSrc, newTeseSrc, newGeomSrc, newFragSrc, newCompSrc);
 }
 
+// Reads the file, replacing each `#include "file"` line with that file's contents, relative to the including file
+static bool readShaderFile(const std::string & file, std::string & r_src) {
+    if (!util::readTextFile(file, r_src)) {
+        return false;
+    }
+
+    std::string dir(file.substr(0, file.find_last_of("/\\") + 1));
+    size_t pos(0), line(1);
+    while (pos < r_src.size()) {
+        size_t end(r_src.find('\n', pos));
+        if (end == std::string::npos) end = r_src.size();
+
+        size_t start(r_src.find_first_not_of(" \t", pos));
+        if (start < end && r_src.compare(start, 8, "#include") == 0) {
+            size_t open(r_src.find('"', start)), close(r_src.find('"', open + 1));
+            if (open >= end || close >= end) {
+                std::cerr << "Malformed include in shader file: " << file << std::endl;
+                return false;
+            }
+            std::string includeFile(dir + r_src.substr(open + 1, close - open - 1));
+            std::string includeSrc;
+            if (!readShaderFile(includeFile, includeSrc)) {
+                std::cerr << "Failed to read included shader file: " << includeFile << std::endl;
+                return false;
+            }
+
+            // So shader compilation error lines match source, though not which file
+            std::stringstream ss;
+            ss << "#line 1\n" << includeSrc << "\n#line " << line + 1;
+            std::string replacement(ss.str());
+            r_src.replace(pos, end - pos, replacement);
+            end = pos + replacement.size();
+        }
+
+        pos = end + 1;
+        ++line;
+    }
+
+    return true;
+}
+
 static u32 loadProgram(
     const std::string & vertFile,
     const std::string & tescFile,
@@ -250,37 +291,37 @@ static u32 loadProgram(
 ) {
     std::string vertSrc, tescSrc, teseSrc, geomSrc, fragSrc, compSrc;
     if (vertFile.size()) {
-        if (!util::readTextFile(vertFile, vertSrc)) {
+        if (!readShaderFile(vertFile, vertSrc)) {
             std::cerr << "Failed to read vertex shader file: " << vertFile << std::endl;
             return 0;
         }
     }
     if (tescFile.size()) {
-        if (!util::readTextFile(tescFile, tescSrc)) {
+        if (!readShaderFile(tescFile, tescSrc)) {
             std::cerr << "Failed to read tessellation control shader file: " << tescFile << std::endl;
             return 0;
         }
     }
     if (teseFile.size()) {
-        if (!util::readTextFile(teseFile, teseSrc)) {
+        if (!readShaderFile(teseFile, teseSrc)) {
             std::cerr << "Failed to read tessellation evaluation shader file: " << teseFile << std::endl;
             return 0;
         }
     }
     if (geomFile.size()) {
-        if (!util::readTextFile(geomFile, geomSrc)) {
+        if (!readShaderFile(geomFile, geomSrc)) {
             std::cerr << "Failed to read geometry shader file: " << geomFile << std::endl;
             return 0;
         }
     }
     if (fragFile.size()) {
-        if (!util::readTextFile(fragFile, fragSrc)) {
+        if (!readShaderFile(fragFile, fragSrc)) {
             std::cerr << "Failed to read fragment shader file: " << fragFile << std::endl;
             return 0;
         }
     }
     if (compFile.size()) {
-        if (!util::readTextFile(compFile, compSrc)) {
+        if (!readShaderFile(compFile, compSrc)) {
             std::cerr << "Failed to read compute shader file: " << compFile << std::endl;
             return 0;
         }
@@ -43,12 +43,13 @@ class MainComp;
 static const ivec2 k_defWindowSize(1280, 720);
 static const std::string k_windowTitle("RLD Flight Simulator");
 
-static constexpr int k_simTexSize(1024);
+static const ivec2 k_simTexSize(1024, 1024);
 static constexpr int k_simSliceCount(100);
 static constexpr float k_simLiftC(1.0f);
 static constexpr float k_simDragC(1.0f);
 static constexpr float k_windframeWidth(14.5f);
 static constexpr float k_windframeDepth(22.0f);
+static const std::chrono::microseconds k_simBudget(4000); // Time given to the simulation each frame
 
 static constexpr float k_gravity(0.0f);//9.8f);
 static const vec3 k_lightDir(glm::normalize(vec3(-1.0f, 0.25f, -1.0f)));
@@ -113,6 +114,9 @@ static bool s_windView;
 
 static mat4 s_rldModelMat;
 static mat3 s_rldNormalMat;
+static bool s_isRldSweeping; // Whether a sweep is in progress
+static mat3 s_rldWindBasis; // The wind basis of the sweep in progress
+static vec3 s_lift, s_drag, s_torq; // From the most recent sweep
 
 static shr<MainComp> s_mainComp;
 static shr<ui::Text> s_textComp;
@@ -514,39 +518,44 @@ static float triggerVal(u08 v) {
 }
 
 static void updatePlane(float dt) {
-    vec3 wind(-s_simObject->velocity()); // wind is equivalent to opposite direction/speed of velocity
-    float windSpeed(glm::length(wind));
-    vec3 windW(wind / -windSpeed); // Normalize. Negative because the W vector is opposite the direction "looked in"
-    vec3 windU(glm::normalize(glm::cross(s_simObject->v(), windW))); // TODO: will break if wind direction is parallel to object's v
-    vec3 windV(glm::cross(windW, windU));
-    mat3 windBasis(windU, windV, windW);
-
-    mat3 rldOrientMat(glm::transpose(windBasis) * s_simObject->orientMatrix());
-    s_rldModelMat = mat4(rldOrientMat) * s_modelMat;
-    s_rldNormalMat = rldOrientMat * s_normalMat;
+    // Start a sweep of the current orientation, whose forces are applied once it's done, a few frames later
+    if (!s_isRldSweeping) {
+        vec3 wind(-s_simObject->velocity()); // wind is equivalent to opposite direction/speed of velocity
+        float windSpeed(glm::length(wind));
+        vec3 windW(wind / -windSpeed); // Normalize. Negative because the W vector is opposite the direction "looked in"
+        vec3 windU(glm::normalize(glm::cross(s_simObject->v(), windW))); // TODO: will break if wind direction is parallel to object's v
+        vec3 windV(glm::cross(windW, windU));
+        s_rldWindBasis = mat3(windU, windV, windW);
+
+        mat3 rldOrientMat(glm::transpose(s_rldWindBasis) * s_simObject->orientMatrix());
+        s_rldModelMat = mat4(rldOrientMat) * s_modelMat;
+        s_rldNormalMat = rldOrientMat * s_normalMat;
+
+        rld::set(*s_model, s_rldModelMat, s_rldNormalMat, k_windframeWidth, k_windframeDepth, glm::length(wind), false);
+        s_isRldSweeping = true;
+    }
 
+    // Advance the sweep by what fits in this frame, and pick up its forces if it's done
     glEnable(GL_DEPTH_TEST);
     glDisable(GL_BLEND);
-
-    rld::set(*s_model, s_rldModelMat, s_rldNormalMat, k_windframeWidth, k_windframeDepth, glm::length(wind), false);
-    rld::sweep();
-
+    if (rld::stepFor(k_simBudget)) {
+        rld::Result result(rld::result());
+        s_lift = s_rldWindBasis * vec3(result.lift.x, result.lift.y, 0.0f); // TODO: figure out what is up with lift along z axis (see move shader)
+        s_drag = s_rldWindBasis * result.drag;
+        s_torq = s_rldWindBasis * result.torq;
+        //s_lift.x = s_lift.y = 0.0f;
+        //s_drag.x = s_drag.y = 0.0f;
+        //s_torq.y = s_torq.z = 0.0f;
+        s_isRldSweeping = false;
+    }
     glDisable(GL_DEPTH_TEST);
     glEnable(GL_BLEND);
 
-    rld::Result result(rld::result());
-    vec3 lift = windBasis * vec3(result.lift.x, result.lift.y, 0.0f); // TODO: figure out what is up with lift along z axis (see move shader)
-    vec3 drag = windBasis * result.drag;
-    vec3 torq = windBasis * result.torq;
-    //lift.x = lift.y = 0.0f;
-    //drag.x = drag.y = 0.0f;
-    //torq.y = torq.z = 0.0f;
-
-    s_simObject->addTranslationalForce(lift + drag);
-    s_simObject->addAngularForce(torq);
+    s_simObject->addTranslationalForce(s_lift + s_drag);
+    s_simObject->addAngularForce(s_torq);
     s_simObject->update(dt);
 
-    s_textComp->string(createTextString(lift, drag, torq, glm::length(s_simObject->velocity())));
+    s_textComp->string(createTextString(s_lift, s_drag, s_torq, glm::length(s_simObject->velocity())));
 }
 
 static void update(float dt) {
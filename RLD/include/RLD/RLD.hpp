@@ -2,12 +2,16 @@
 
 
 
+#include <chrono>
+#include <string>
+
 #include "Common/Global.hpp"
 #include "Common/Model.hpp"
 
 
 
 struct GLFWwindow;
+class Shader;
 
 
 
@@ -16,74 +20,605 @@ namespace rld {
     // Mirrors GPU struct
     struct Result {
         vec3 lift;
-        float _0;
+        s32 geoCount; // Geometry edge pixels found. Beyond the max the rest were dropped. The sweep's result has the most of any slice
         vec3 drag;
-        float _1;
+        s32 airCount; // Same for air pixels
         vec3 torq;
-        float _2;
+        float _0;
+    };
+
+    // Mirrors GPU struct
+    // Counts are the most of any orientation or tile, and the rest are totals across them. When mirrored, only the
+    // simulated half is counted
+    struct SliceStats {
+        s32 geoCount; // Geometry edge pixels found, including any dropped
+        s32 airCount; // Same for air pixels
+        s32 geoOverflow; // Geometry edge pixels dropped for want of room
+        s32 airOverflow; // Same for air pixels
+        s32 searchSteps; // Steps the searches for air and geometry took, each jump over empty space counting as one
+        s32 turbulenceHits; // Searches that ran into turbulence, or found it past the turbulence distance
+    };
+
+    // Stages of a slice on the GPU, as timed by the profiler, in the order they run
+    // `setup` is everything up to clearing the flag texture, and `debug` the visualizations. A slice either renders
+    // its geometry, then prospects and compacts it, or replays it from the geometry cache with `scatter`
+    enum class ProfileStage { setup, geometry, prospect, compact, scatter, turbulenceCopy, draw, distance, outline, move, debug, count };
+
+    // How long one stage took, in microseconds, over the profiler's recent slices and sweeps
+    struct StageProfile {
+        const char * name;
+        int sliceCount; // Slices timed that ran the stage
+        float sliceMin, sliceAvg, sliceP99;
+        int sweepCount; // Sweeps timed that ran the stage
+        float sweepMin, sweepAvg, sweepP99; // Of the stage's total over each sweep
+    };
+
+    // Where the simulation is run
+    // The CPU backend mirrors the GPU pipeline stage for stage across all cores and needs no OpenGL context. It follows
+    // GL's rasterization rules, but which of two coincident faces is nearest the wind comes down to float rounding, which
+    // differs between the backends, and a pixel that differs changes the air flowing from it through later slices.
+    // At 256x256 and 50 slices, sweep totals agree to within about 1% for the airfoil and sphere, apart from near zero
+    // lift, and about 10% for the F-18, with its many coincident faces. See the visualizer's compare key. Cloth is not
+    // supported on the CPU
+    enum class Backend { gpu, cpu };
+
+    class CPUBackend;
+    class GPUProfiler;
+    class SlabIndex;
+    struct Constants;
+    struct CheckpointKey;
+    struct GeometryCacheEntry;
+    struct GeometryKey;
+    struct ResultsReadback;
+    struct SliceTimer;
+    struct SweepCheckpoint;
+
+    // One independent simulation, owning its own shaders, buffers, textures, and results
+    // Any number may exist side by side, each with its own texture size, slice count, and variables
+    class Simulator {
+
+        public:
+
+        Simulator();
+        Simulator(const Simulator &) = delete;
+        ~Simulator();
+
+        Simulator & operator=(const Simulator &) = delete;
+
+        // Must be called once before anything else, after OpenGL has been setup unless using the CPU backend
+        bool setup(
+            const ivec2 & texSize, // Width and height of the textures. Pixels are square, so the windframe has the same aspect ratio
+            int sliceCount,
+            float liftC, // Constant lift multiplier
+            float dragC, // Constant drag multiplier
+            float turbulenceDist, // Distance in wind space before turbulence starts
+            float maxSearchDist, // Max distance in wind space to look for air from geometry or vice versa
+            float windShadDist, // Distance in wind space z that wind shadow will extend
+            float backforceC, // Constant backforce multiplier
+            float flowback, // Fraction of air's lateral velocity to remain after 1 unit of distance
+            float initVelC, // Constant muliplier for initial velocity of newly created air
+            bool doSide, // Should the side texture be created
+            bool doCloth, // Is this cloth simulation
+            Backend backend = Backend::gpu,
+            int batchCapacity = 1 // Max orientations `sweepBatch` advances at once. Each needs its own textures and buffers
+        );
+
+        // Sets these variables at the start of a sweep. Optional
+        void setVariables(float turbulenceDist, float maxSearchDist, float windShadDist, float backforceC, float flowback, float initVelC);
+
+        // Sets the parameters of the simulation. Should be called once before the first sweep or whenever these variables change
+        // With `symmetric`, a model that is its own mirror image across wind x = 0 has only half of it simulated. See `mirrored`
+        void set(
+            const Model & model,
+            const mat4 & modelMat, // The matrix that transforms the model into wind space
+            const mat3 & normalMat, // The matrix that transforms the model's normals into wind space
+            float windframeWidth, // The width of the windframe, whose height follows from the textures' aspect ratio. Should be large enough to fully encapsulate the model with some excess
+            float windframeDepth, // The depth of the windframe. Should be large enough to fully encapsulate the model with some excess
+            float windSpeed, // The speed of the wind. Again, the wind always moves in the -z direction in wind space
+            bool debug, // Enables certain unnecessary features such as side view rendering and active pixel highlighting
+            bool symmetric = false // Whether to simulate only one half of a mirror symmetric model when possible
+        );
+
+        // Enables or disables caching of the geometry pass, which renders the model and finds its pixels for each slice
+        // Sweeps of an orientation already in the cache skip straight to moving air, so repeated sweeps that only differ
+        // by `setVariables` are much faster. Orientation is the model, its matrices and those of its sub models, the
+        // windframe, and the wind speed. Disabling frees the cache. Has no effect with cloth
+        void setGeometryCaching(bool enable);
+
+        // Enables or disables fitting of the windframe to the model. Takes effect at the next `set`
+        // When enabled, the windframe width given to `set` is replaced by the smallest that fits the model's wind space
+        // bounds plus `margin` to each side, leaving room for air to be deflected. The windframe depth, and so the slice size,
+        // is kept, but sweeps skip the empty slices in front of the model and those more than `backMargin` behind it,
+        // leaving room for wind shadow. Skipped slices have no result. Has no effect with cloth
+        void setWindframeFitting(bool enable, float margin, float backMargin);
+
+        // Splits the windframe into a grid of tiles, each swept in turn with the textures and buffers given to `setup`,
+        // for resolutions beyond what fits in memory. The effective texture size is the tile count times the texture
+        // size less `halo` pixels to each side. Each tile also covers `halo` pixels of its neighbors' share, so air near
+        // a border still finds geometry across it, but only forces on its own share are counted. Air that travels past
+        // the halo is lost. A tile count of 1 with no halo disables tiling. Tiles the model doesn't touch are skipped.
+        // Geometry caching is not used when tiled. Must be called after `setup`, and takes effect at the next `set`.
+        // Not supported with cloth
+        bool setTiling(const ivec2 & tileCount, int halo);
+
+        // When enabled, drag is found from the exact area and normals of what of the model lies in each slice, as clipped
+        // by `crossSectionSlab`, rather than one pixel's worth per geometry pixel. Drag then no longer depends on how
+        // surfaces happen to fall on the pixel grid, and so stays stable at lower texture sizes. Lift is unaffected.
+        // Only supported by the CPU backend. Must be called after `setup`, and takes effect at the next sweep
+        bool setExactDrag(bool enable);
+
+        // Enables or disables attributing the forces to the sub models they act on, as `subModelResults`, so the share
+        // of each part comes from the one sweep rather than one sweep per part removed. Each geometry pixel takes the sub
+        // model nearest the wind, so a part wholly covered by another within a slice gets nothing for it. Geometry
+        // caching and symmetry are not used while enabled. On the GPU, the sub models' shares are added atomically, so
+        // may differ in the last bits from sweep to sweep, and neither `sweepBatch` nor `sweepAsync` finds them.
+        // Not supported with cloth. Must be called after `setup`, and takes effect at the next `set`
+        bool setSubModelAttribution(bool enable);
+
+        // Enables or disables saving sweeps every `interval` slices, so a sweep that differs from the last only by sub
+        // models' matrices resumes from the last checkpoint before them. Must be called after `setup`
+        bool setCheckpointing(bool enable, int interval);
+
+        // Sets how many levels of detail sweeps after `set` go through, each at twice the resolution of the last, for a
+        // quick answer while the caller is still changing things. See `level`. Takes effect at the next `set`
+        bool setProgressive(int levelCount);
+
+        // Enables or disables spacing the slices by the model rather than evenly. They are closer together where its
+        // cross section changes quickly, as at leading edges and control surfaces, and further apart where it barely
+        // changes, as along a fuselage, so fewer slices give the same accuracy. A quarter of the spacing is even
+        // regardless. When fitting the windframe, every slice is within the fitted depth. Each slice's results are for
+        // its own depth. Batches share the spacing, found from all their orientations. Not supported with cloth. Takes
+        // effect at the next `set`
+        bool setAdaptiveSlicing(bool enable);
+
+        // Enables or disables timing each stage of every slice on the GPU, to find where sweeps spend their time. The
+        // timings are read back some slices later, once the GPU has them, so nothing waits on them. If `reportPeriod`
+        // is positive, `profileReport` is written to standard output every that many sweeps. Enabling again starts
+        // over. Only supported by the GPU backend, and must be called after `setup`
+        bool setProfiling(bool enable, int reportPeriod = 0);
+
+        // Does one slice and returns if it was the last one. When tiled, each tile's slices are done in turn
+        // Requires OpenGL state:
+        // - `GL_DEPTH_TEST` disabled
+        // - `GL_BLEND` enabled
+        bool step(bool isExternalCall = true);
+
+        // Does a full sweep
+        // Requires OpenGL state:
+        // - `GL_DEPTH_TEST` enabled
+        // - `GL_BLEND` disabled
+        void sweep();
+
+        // Does a full sweep without waiting for it to finish, and returns a ticket for its results
+        // The GPU works through the sweep while the caller does other things, and `tryResult` picks up the results once
+        // ready. The results of the last few sweeps are kept, after which the oldest are dropped. Returns 0 with cloth
+        // Requires the same OpenGL state as `sweep`
+        u64 sweepAsync();
+
+        // If the results of the sweep with the given ticket have arrived, makes them what `result` and `results` return
+        // and returns true. Never blocks. Returns false for a ticket whose results have been dropped
+        bool tryResult(u64 ticket);
+
+        // Advances the sweep by as many slices as are expected to fit in the budget, for callers with a frame to keep to.
+        // At least one slice is done. The cost of a slice is measured as it goes, with timer queries on the GPU and a
+        // clock on the CPU, and until there is a measure only one slice is done per call. Returns true once `result` and
+        // `results` hold a newly finished sweep's results. Until then they keep the previous sweep's, so `set` should
+        // wait for it. On the GPU, the results are picked up as with `tryResult`, and no new sweep is begun until they
+        // are. On the GPU, sub model results are not found, and no other `GL_TIME_ELAPSED` query may be active
+        // Requires the same OpenGL state as `sweep`
+        bool stepFor(std::chrono::microseconds budget);
+
+        // Does a full sweep of each orientation, replacing the matrices given to `set`. `normalMats` must correspond to `modelMats`
+        // Up to the batch capacity given to `setup` are advanced in lock-step, sharing every dispatch. Debug features
+        // and geometry caching are not used. Returns the result of each orientation. Afterwards, `result` and `results`
+        // are those of the last orientation
+        // Requires the same OpenGL state as `sweep`
+        std::vector<Result> sweepBatch(const std::vector<mat4> & modelMats, const std::vector<mat3> & normalMats);
+
+        // Resets the sweep to the first slice
+        void reset();
+
+        // Returns the index of the slice that would be NEXT
+        int slice() const;
+
+        // Returns the index of the tile being swept, in row major order
+        int tile() const;
+
+        // Returns the total number of slices
+        int sliceCount() const;
+
+        // Returns how many times the texture size and slice count were halved for the results, 0 being full resolution
+        int level() const;
+
+        // Returns the result of the sweep
+        const Result & result() const;
+
+        // Returns the result for each slice
+        const std::vector<Result> & results() const;
+
+        // Returns the result for each slice and sub model, at index `slice * subModelCount + subModelI`, when attributing.
+        // Geo and air counts are zero. Only geometry nearest the wind is counted, see `setSubModelAttribution`
+        const std::vector<Result> & subModelResults() const;
+
+        // Returns the sub model's share of the result of the sweep, when attributing
+        Result subModelResult(int subModelI) const;
+
+        // Returns whether any slice of the results had more geo or air pixels than fit, so some were dropped
+        bool overflowed() const;
+
+        // Returns the statistics of each slice of the sweep whose results are held, for sizing the buffers to a model.
+        // Below full resolution there are only as many as that sweep's slices. Slices skipped by fitting are zero
+        const std::vector<SliceStats> & stats() const;
+
+        // Returns how long each stage took over the recent slices and sweeps, or nothing if not profiling
+        std::vector<StageProfile> profile() const;
+
+        // Returns `profile` as a table, or nothing if not profiling
+        std::string profileReport() const;
+
+        // Returns whether sweeps simulate only one half of the windframe and mirror it, as `set` may have asked for
+        bool mirrored() const;
+
+        // Texture handles are 0 when using the CPU backend
+        u32 frontTex() const;
+        u32 sideTex() const;
+        u32 turbulenceTex() const;
+
+        ivec2 texSize() const;
+
+        // Returns the width and height of the windframe in use. The width is that given to `set` unless fitting
+        vec2 windframeSize() const;
+
+
+        private:
+
+        bool setupShaders();
+        bool setupBuffers();
+        bool setupTextures();
+        bool setupFramebuffer();
+        void setupIndexTexture(bool enable);
+
+        void computeProspect();
+        void computeCompact();
+        void computeDispatch(int stage);
+        void computeDraw();
+        void computeDistance();
+        void computeOutline();
+        void computeMove();
+        void computePretty();
+        void computeSide();
+        void renderGeometry();
+
+        void uploadConstants();
+        void resetCounters(bool both);
+        void clearResults();
+        void clearSubModelResults();
+        void clearStats();
+        void markStage(ProfileStage stage);
+        void sumResults();
+        void collectSliceTimers();
+        void downloadResults();
+        void queueResults();
+        void resetConstants();
+        void clearTurbTex();
+        void clearShadTex();
+        void clearFlagTex();
+        void clearTileEpochs();
+        void clearSideTex();
+        void setBindings();
+
+        bool stepCPU();
+
+        GeometryKey geometryKey() const;
+        void beginGeometryCache();
+        void endGeometryCache();
+        void abandonGeometryCache();
+        void recordSliceStart();
+        void recordSliceResult();
+        void uploadCachedResults();
+        void clearFrontTex();
+        void computeScatter();
+
+        void beginCheckpoints();
+        void endCheckpoints();
+        void saveCheckpoint();
+        void restoreCheckpoint();
+        void freeCheckpoints();
+        int findFirstMovedSlice(const CheckpointKey & key) const;
+
+        void applyLevel();
+        void spreadResults(Result * results, int stride, int level) const;
+        void fitWindframe();
+        bool findWindBounds(vec3 & r_min, vec3 & r_max) const;
+        bool isMirrorSymmetric() const;
+        ivec2 effectiveTexSize() const;
+        void resetTileConstants();
+        void resetSliceConstants();
+        void scheduleSlices(float front, float back);
+        int sliceAt(float depth) const;
+
+        int m_workGroupSize; // At least 1024
+        ivec2 m_workGroupSize2D; // At least 32x32
+        ivec2 m_texSize; // Width and height of the textures
+        int m_maxGeoPixels;
+        int m_maxAirPixels;
+        int m_sliceCount;
+        int m_batchCapacity; // Number of layers in each texture, and of regions in each pixel buffer
+        float m_liftC;
+        float m_dragC;
+
+        const Model * m_model;
+        mat4 m_modelMat;
+        mat3 m_normalMat;
+        vec2 m_windframeSize; // Width and height, in the textures' aspect ratio
+        float m_windframeDepth;
+        bool m_isFitting; // Whether `set` fits the windframe to the model
+        bool m_isSymmetric; // Whether `set` asked for only one half of the windframe to be simulated
+        bool m_isMirrored; // Whether it is, the model being its own mirror image
+        float m_fitMargin; // Wind space distance left to each side of the model when fitting
+        float m_fitBackMargin; // Wind space distance left behind the model when fitting
+        int m_firstSlice; // The first slice a sweep covers
+        int m_endSlice; // One past the last slice a sweep covers
+        ivec2 m_tileCount;
+        int m_tileHalo; // Pixels each tile shares with its neighbors to each side
+        std::vector<int> m_tiles; // The tiles a sweep covers
+        float m_sliceSize;
+        float m_turbulenceDist;
+        float m_maxSearchDist;
+        float m_windShadDist;
+        float m_backforceC;
+        float m_flowback;
+        float m_initVelC;
+        float m_windSpeed;
+        float m_dt; // The time it would take to travel `m_sliceSize` at `m_windSpeed`
+        bool m_debug; // Whether to enable non essentials like side view or active pixel highlighting
+        bool m_doSide; // Whether to render side texture
+        bool m_doCloth; // Whether this is a cloth simulation
+        Backend m_backend;
+        unq<CPUBackend> m_cpuBackend;
+        bool m_isExactDrag;
+        bool m_isAttributing; // Whether forces are attributed to sub models
+        bool m_isAdaptiveSlicing;
+        std::vector<float> m_sliceDepths; // When slicing adaptively, the distance from the front of the windframe to the front of each slice, then to the back of the last. Empty otherwise
+        bool m_isCheckpointing;
+        int m_checkpointInterval; // Slices between checkpoints
+        std::vector<unq<SweepCheckpoint>> m_checkpoints; // One per interval after the first slice, made as needed
+        unq<CheckpointKey> m_checkpointKey; // What the checkpoints were made of
+        bool m_areCheckpointsValid; // Whether the last sweep to make checkpoints finished
+        bool m_isCheckpointSweep; // Whether the current sweep makes checkpoints
+        SweepCheckpoint * m_resumeCheckpoint; // The checkpoint the current sweep resumes from, if any
+        int m_levelCount; // Levels of detail progressive sweeps go through, 1 if not progressive
+        int m_level; // Times the texture size and slice count are halved for the current sweep
+        int m_resultLevel; // Same for the sweep whose results are held
+        std::vector<unq<SlabIndex>> m_slabIndices; // One per layer. Empty with cloth
+
+        int m_currentSlice; // slice index [0, sliceCount)
+        int m_currentTile; // index into `m_tiles`
+        std::vector<Result> m_results; // Results for each slice
+        Result m_result; // Cumulative result of all slices
+        std::vector<Result> m_subModelResults; // Results for each sub model of each slice, when attributing
+        std::vector<Result> m_sweepResults; // Results for each slice of the CPU sweep in progress, which become `m_results` once it finishes
+        std::vector<Result> m_sweepSubModelResults; // Same for `m_subModelResults`
+        std::vector<SliceStats> m_stats; // Statistics for each slice of the sweep whose results are held
+        std::vector<SliceStats> m_sweepStats; // Same for `m_sweepResults`
+        int m_swap; // Only used for the air pixel buffer
+        int m_batchSize; // Number of orientations being advanced, one per layer
+        std::vector<mat4> m_batchModelMats; // Only set by `sweepBatch`
+        std::vector<mat3> m_batchNormalMats; // Only set by `sweepBatch`
+        std::vector<Result> m_batchResults; // Results for each slice of each orientation being advanced
+        bool m_isAsyncSweep; // Whether the current sweep's results should be queued rather than downloaded
+        std::vector<ResultsReadback> m_readbacks; // Where asynchronous sweeps leave their results, used in turn
+        u64 m_lastTicket; // The ticket of the last asynchronous sweep
+        u64 m_stepForTicket; // The ticket of the last sweep `stepFor` finished on the GPU, until its results are picked up
+        std::vector<SliceTimer> m_sliceTimers; // The timer queries of `stepFor`'s recent calls
+        float m_sliceCost; // Running average of the microseconds a slice takes, or 0 if not yet measured
+        unq<GPUProfiler> m_profiler; // Only while profiling
+        int m_flagEpoch; // Of the current slice. The flag texture and tile epochs are only cleared once every epoch has been used
+        int m_flagEpochCount; // How many epochs fit in a flag alongside its largest value
+        bool m_isFrontPretty; // Whether `pretty` has overwritten the front texture, so it must be cleared before the next slice
+
+        unq<Shader> m_foilShader, m_foilShaderDebug;
+        unq<Shader> m_prospectShader, m_prospectShaderDebug;
+        unq<Shader> m_drawShader, m_drawShaderDebug;
+        unq<Shader> m_outlineShader, m_outlineShaderDebug;
+        unq<Shader> m_moveShader, m_moveShaderDebug;
+        unq<Shader> m_prettyShader, m_sideShader;
+        unq<Shader> m_prospectShaderCapture, m_prospectShaderCaptureDebug;
+        unq<Shader> m_scatterShader, m_scatterShaderDebug;
+        unq<Shader> m_compactShader, m_compactShaderCapture;
+        unq<Shader> m_distanceShader;
+        unq<Shader> m_dispatchShader;
+
+        unq<Constants> m_constants; // CPU copy of constants
+
+        u32 m_constantsBuffer;
+        u32 m_resultsBuffer;
+        u32 m_geoPixelsBuffer;
+        u32 m_airPixelsBuffer[2];
+        u32 m_airGeoMapBuffer;
+        u32 m_sliceStartsBuffer; // Where the geometry cache's pixel count is copied before each slice
+        u32 m_geoResultsBuffer; // Where each slice's result is copied after the geometry pass
+        u32 m_rowCountsBuffer; // Each row's geometry and edge pixel counts, from which `compact` finds where its pixels go
+        u32 m_blockResultsBuffer; // Each prospect work group's drag and torque, summed in a fixed order by `compact`, then each move work group's lift and torque
+        u32 m_subModelResultsBuffer; // Results for each sub model of each slice, when attributing. Grows to fit the model
+        s64 m_subModelResultsSize; // Size of `m_subModelResultsBuffer` in bytes
+        u32 m_statsBuffer; // Statistics for each slice, shared by all layers
+        u32 m_blockCountsBuffer; // How many air pixels each draw and outline work group appends, from which each finds where its own go
+        u32 m_dispatchBuffer; // The work group counts of draw, outline, move, and prospect, as sized on the GPU
+        u32 m_tileEpochsBuffer; // The epoch each 8x8 tile of each layer was last found to have geometry in
+        u32 m_tilesBuffer; // The tiles with geometry in them this slice, listed as the geometry is rendered, for prospect
+
+        bool m_isGeoCaching;
+        std::vector<unq<GeometryCacheEntry>> m_geoCache; // Most recently used first
+        GeometryCacheEntry * m_geoCacheEntry; // The entry being captured or replayed by the current sweep, if any
+        bool m_isGeoReplay; // Whether the current sweep is replaying `m_geoCacheEntry` rather than capturing it
+        int m_geoCacheCapacity; // Max pixels in a GPU cache entry
+
+        std::vector<u32> m_fbos; // The handles for the framebuffer objects, one per layer
+        u32 m_depthRenderbuffer; // The handle for the framebuffers' shared depth attachment
+        u32 m_frontTex_unorm; // A view of m_frontTex_uint that is RGBA8
+        u32 m_frontTex_uint; // The handle for the front texture array (RGBA8UI)
+        u32 m_frontLayerTex; // A 2D view of the first layer of m_frontTex_unorm
+        u32 m_normTex; // The handle for the normal texture array (RGBA16_SNORM, or octahedral RG16_SNORM if packing pixels)
+        u32 m_flagTex; // The handle for the flag texture array (R32UI)
+        u32 m_turbTex; // The handle for the turbulence texture array (R8)
+        u32 m_turbLayerTex; // A 2D view of the first layer of m_turbTex
+        u32 m_prevTurbTex; // The handle for the previous turbulence texture array (R8)
+        u32 m_shadTex; // The handle for the wind shadow texture array (R8)
+        u32 m_indexTex; // The handle for the index texture array (R32UI), of triangle index + 1 with cloth and sub model index + 1 otherwise
+        u32 m_sideTex; // The handle for the side texture (RGBA8)
+        u32 m_distTex[2]; // The handles for the distance field texture arrays (R8UI), which `distance` passes alternate between
+
     };
 
-    // Must be called once at the start of the program after OpenGL has been setup
+    // A vertex of the model's surface within a slab, in wind space
+    struct SlabVertex {
+        vec3 pos;
+        vec3 norm; // Interpolated from the triangle's vertex normals, so not necessarily of unit length
+    };
+
+    // The part of one triangle within a slab. A triangle clipped by two planes has at most five vertices
+    struct SlabPolygon {
+        SlabVertex verts[5];
+        int count;
+        int subModelI; // Index of the sub model the triangle belongs to
+        int triI; // Index of the triangle within its mesh, as `gl_PrimitiveID`
+        int clipEdges; // Bit i is set if the edge from vertex i to the next lies along a plane of the slab, made by clipping
+    };
+
+    // The images the geometry pass renders for one slab, row major from the bottom left
+    struct SlabImages {
+        ivec2 texSize;
+        std::vector<u32> colors; // As the front texture's RGBA8UI texels, r | g << 8 | b << 16 | a << 24. r is the geo bit, g and b the sub-pixel wind position in 1/255ths of a pixel
+        std::vector<vec3> normals; // Wind space, quantized as by the RGBA16_SNORM normal texture. Zero where there is no geometry
+        std::vector<u32> indices; // As the cloth index texture, 1 + the index of the triangle within its mesh, or 0
+    };
+
+    // Renders the part of the model between wind z `sliceZ` and `sliceZ - sliceSize` on the CPU, needing no OpenGL
+    // context. Follows the same rules as the CPU backend's geometry pass, including the outline then fill coverage of
+    // the GPU's two draws. For producing inputs headless, and as a reference for the GPU raster. Only hard meshes are
+    // rendered, as soft meshes only live on the GPU. A thread count of zero will use as many threads as there are cores
+    SlabImages rasterizeSlab(
+        const Model & model,
+        const mat4 & modelMat, // The matrix that transforms the model into wind space
+        const mat3 & normalMat, // The matrix that transforms the model's normals into wind space
+        const ivec2 & texSize,
+        const vec2 & windframeSize,
+        const vec2 & windframeCenter, // Wind space xy of the center of the windframe
+        float sliceZ, // Wind z of the near side of the slab
+        float sliceSize,
+        int threadCount = 0
+    );
+
+    // Finds exactly what of the model lies between wind z `sliceZ` and `sliceZ - sliceSize`, by clipping each triangle
+    // to the slab rather than rasterizing it, so nothing is missed however thin and nothing depends on raster rules.
+    // The polygons are ready to be rasterized, or for their edges or areas to be used directly. They are in sub model
+    // then triangle order, whatever the thread count. Only hard meshes are included, as soft meshes only live on the
+    // GPU. A thread count of zero will use as many threads as there are cores
+    std::vector<SlabPolygon> crossSectionSlab(
+        const Model & model,
+        const mat4 & modelMat, // The matrix that transforms the model into wind space
+        const mat3 & normalMat, // The matrix that transforms the model's normals into wind space
+        float sliceZ, // Wind z of the near side of the slab
+        float sliceSize,
+        int threadCount = 0
+    );
+
+    // The free functions below forward to a default simulator, for programs that only need one
+
     bool setup(
-        int texSize,
+        const ivec2 & texSize,
         int sliceCount,
-        float liftC, // Constant lift multiplier
-        float dragC, // Constant drag multiplier
-        float turbulenceDist, // Distance in wind space before turbulence starts
-        float maxSearchDist, // Max distance in wind space to look for air from geometry or vice versa
-        float windShadDist, // Distance in wind space z that wind shadow will extend
-        float backforceC, // Constant backforce multiplier
-        float flowback, // Fraction of air's lateral velocity to remain after 1 unit of distance
-        float initVelC, // Constant muliplier for initial velocity of newly created air
-        bool doSide, // Should the side texture be created
-        bool doCloth // Is this cloth simulation
+        float liftC,
+        float dragC,
+        float turbulenceDist,
+        float maxSearchDist,
+        float windShadDist,
+        float backforceC,
+        float flowback,
+        float initVelC,
+        bool doSide,
+        bool doCloth,
+        Backend backend = Backend::gpu,
+        int batchCapacity = 1
     );
 
-    // Sets these variables at the start of a sweep. Optional
     void setVariables(float turbulenceDist, float maxSearchDist, float windShadDist, float backforceC, float flowback, float initVelC);
 
-    // Sets the parameters of the simulation. Should be called once before the first sweep or whenever these variables change
     void set(
         const Model & model,
-        const mat4 & modelMat, // The matrix that transforms the model into wind space
-        const mat3 & normalMat, // The matrix that transforms the model's normals into wind space
-        float windframeWidth, // The width and height of the windframe. Should be large enough to fully encapsulate the model with some excess
-        float windframeDepth, // The depth of the windframe. Should be large enough to fully encapsulate the model with some excess
-        float windSpeed, // The speed of the wind. Again, the wind always moves in the -z direction in wind space
-        bool debug // Enables certain unnecessary features such as side view rendering and active pixel highlighting
+        const mat4 & modelMat,
+        const mat3 & normalMat,
+        float windframeWidth,
+        float windframeDepth,
+        float windSpeed,
+        bool debug,
+        bool symmetric = false
     );
 
-    // Does one slice and returns if it was the last one
-    // Requires OpenGL state:
-    // - `GL_DEPTH_TEST` disabled
-    // - `GL_BLEND` enabled
+    void setGeometryCaching(bool enable);
+
+    void setWindframeFitting(bool enable, float margin, float backMargin);
+
+    bool setTiling(const ivec2 & tileCount, int halo);
+
+    bool setExactDrag(bool enable);
+
+    bool setSubModelAttribution(bool enable);
+
+    bool setCheckpointing(bool enable, int interval);
+
+    bool setProgressive(int levelCount);
+
+    bool setAdaptiveSlicing(bool enable);
+
+    bool setProfiling(bool enable, int reportPeriod = 0);
+
     bool step(bool isExternalCall = true);
 
-    // Does a full sweep
-    // Requires OpenGL state:
-    // - `GL_DEPTH_TEST` enabled
-    // - `GL_BLEND` disabled
     void sweep();
 
-    // Resets the sweep to the first slice
+    u64 sweepAsync();
+
+    bool tryResult(u64 ticket);
+
+    bool stepFor(std::chrono::microseconds budget);
+
+    std::vector<Result> sweepBatch(const std::vector<mat4> & modelMats, const std::vector<mat3> & normalMats);
+
     void reset();
 
-    // Returns the index of the slice that would be NEXT
     int slice();
 
-    // Returns the total number of slices
+    int tile();
+
     int sliceCount();
 
-    // Returns the result of the sweep
+    int level();
+
     const Result & result();
 
-    // Returns the result for each slice
     const std::vector<Result> & results();
 
+    const std::vector<Result> & subModelResults();
+
+    Result subModelResult(int subModelI);
+
+    bool overflowed();
+
+    const std::vector<SliceStats> & stats();
+
+    std::vector<StageProfile> profile();
+
+    std::string profileReport();
+
+    bool mirrored();
+
     u32 frontTex();
     u32 sideTex();
     u32 turbulenceTex();
 
-    int texSize();
+    ivec2 texSize();
 
+    vec2 windframeSize();
 }
\ No newline at end of file
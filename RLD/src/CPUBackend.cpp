@@ -0,0 +1,1192 @@
+#include "CPUBackend.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "glm/packing.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define RLD_SSE2
+    #include <emmintrin.h>
+#endif
+
+
+
+namespace rld {
+
+    static constexpr bool k_doSearchSkipping(false); // Whether to build the distance field so searches can jump over empty space. Results are the same either way, but with searches spread across cores it only pays off when they are hundreds of pixels long
+
+    // Returns one of <1, 0>, <-1, 0>, <0, 1>, <0, -1> corresponding to dir
+    static ivec2 getPixelDelta(const vec2 & dir) {
+        vec2 signs(glm::sign(dir));
+        vec2 mags(dir * signs);
+        if (mags.y >= mags.x) {
+            return ivec2(0, int(signs.y));
+        }
+        else {
+            return ivec2(int(signs.x), 0);
+        }
+    }
+
+    static vec2 safeNormalize(const vec2 & v) {
+        float d(glm::dot(v, v));
+        return d > 0.0f ? v / std::sqrt(d) : vec2();
+    }
+
+    static vec3 safeNormalize(const vec3 & v) {
+        float d(glm::dot(v, v));
+        return d > 0.0f ? v / std::sqrt(d) : vec3();
+    }
+
+    // Positive if `p` is to the left of the directed edge `a` -> `b`
+    static float edgeFunction(const vec2 & a, const vec2 & b, const vec2 & p) {
+        return (b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x);
+    }
+
+    // Top-left fill convention for a counter-clockwise triangle with y up
+    static bool isTopLeft(const vec2 & a, const vec2 & b) {
+        return b.y < a.y || (b.y == a.y && b.x < a.x);
+    }
+
+    // GL's diamond-exit rule: a line makes a fragment if it passes through the pixel's diamond, |x| + |y| < 0.5 about
+    // its center, and doesn't end in it. As the spec does in principle, the line is moved down and left by an amount
+    // too small to matter but where it lies on a boundary, so that it falls on one side
+    static constexpr double k_linePerturbation(1.0e-7);
+    static bool isLineFragment(const vec2 & a, const vec2 & b, int x, int y) {
+        double u0(double(a.x) - (x + 0.5) - k_linePerturbation), v0(double(a.y) - (y + 0.5) - k_linePerturbation * k_linePerturbation);
+        double u1(double(b.x) - (x + 0.5) - k_linePerturbation), v1(double(b.y) - (y + 0.5) - k_linePerturbation * k_linePerturbation);
+        if (std::abs(u1) + std::abs(v1) < 0.5) {
+            return false;
+        }
+        // Clip the line to each of the diamond's four sides
+        double du(u1 - u0), dv(v1 - v0);
+        double tMin(0.0), tMax(1.0);
+        for (double su : { -1.0, 1.0 }) {
+            for (double sv : { -1.0, 1.0 }) {
+                double p(su * du + sv * dv), q(0.5 - su * u0 - sv * v0);
+                if (p > 0.0) tMax = std::min(tMax, q / p);
+                else if (p < 0.0) tMin = std::max(tMin, q / p);
+                else if (q <= 0.0) return false;
+            }
+        }
+        return tMin < tMax;
+    }
+
+    // Mirrors the quantization of the RGBA16_SNORM normal texture
+    static vec3 quantizeSnorm16(const vec3 & v) {
+        return glm::round(glm::clamp(v, -1.0f, 1.0f) * 32767.0f) / 32767.0f;
+    }
+
+
+
+    CPUBackend::CPUBackend(const ivec2 & texSize, int maxGeoPixels, int maxAirPixels, int sliceCount, int threadCount) :
+        m_pool(threadCount),
+        m_clipper(m_pool),
+        m_texSize(texSize),
+        m_quarterSize(texSize / 4),
+        m_maxGeoPixels(maxGeoPixels),
+        m_maxAirPixels(maxAirPixels),
+        m_constants(),
+        m_isExactDrag(false),
+        m_front(texSize.x * texSize.y),
+        m_norm(texSize.x * texSize.y),
+        m_index(texSize.x * texSize.y),
+        m_subModel(texSize.x * texSize.y),
+        m_depth(texSize.x * texSize.y),
+        m_flag(texSize.x * texSize.y),
+        m_turb(m_quarterSize.x * m_quarterSize.y),
+        m_prevTurb(m_quarterSize.x * m_quarterSize.y),
+        m_shad(m_quarterSize.x * m_quarterSize.y),
+        m_dist(texSize.x * texSize.y),
+        m_prevDist(texSize.x * texSize.y),
+        m_geoPixels(),
+        m_airPixels(),
+        m_prevAirPixels(),
+        m_geoCount(0),
+        m_airCount(0),
+        m_airGeoMap(maxAirPixels),
+        m_results(sliceCount),
+        m_subModelResults(),
+        m_stats(sliceCount)
+    {
+        m_geoPixels.reserve(m_maxGeoPixels);
+        m_airPixels.reserve(m_maxAirPixels);
+        m_prevAirPixels.reserve(m_maxAirPixels);
+
+        int chunks(m_pool.chunkCount(std::max(texSize.y, maxGeoPixels)));
+        m_chunkGeoPixels.resize(chunks);
+        m_chunkCachedPixels.resize(chunks);
+        m_chunkShadWrites.resize(chunks);
+        m_chunkAirs.resize(chunks);
+        m_chunkAirTexCoords.resize(chunks);
+        m_chunkAirGeoMaps.resize(chunks);
+        m_chunkSpawns.resize(chunks);
+        m_chunkTurbAirs.resize(chunks);
+        m_chunkTurbWrites.resize(chunks);
+        m_chunkForces.resize(chunks);
+        m_chunkTorqs.resize(chunks);
+        m_chunkSubModelResults.resize(chunks);
+        m_chunkStats.resize(chunks);
+    }
+
+    void CPUBackend::reset() {
+        std::fill(m_turb.begin(), m_turb.end(), u08(0));
+        std::fill(m_prevTurb.begin(), m_prevTurb.end(), u08(0));
+        std::fill(m_shad.begin(), m_shad.end(), u08(0));
+        std::fill(m_results.begin(), m_results.end(), Result{});
+        std::fill(m_subModelResults.begin(), m_subModelResults.end(), Result{});
+        std::fill(m_stats.begin(), m_stats.end(), SliceStats{});
+        m_airPixels.clear();
+        m_prevAirPixels.clear();
+    }
+
+    void CPUBackend::step(const Constants & constants, const Model & model, const mat4 & modelMat, const mat3 & normalMat, GeometryCacheEntry * r_capture) {
+        m_constants = constants;
+        if (m_subModelResults.size() != m_results.size() * m_constants.subModelCount) {
+            m_subModelResults.assign(m_results.size() * m_constants.subModelCount, Result{});
+        }
+
+        std::swap(m_airPixels, m_prevAirPixels);
+        m_airPixels.clear();
+
+        renderGeometry(model, modelMat, normalMat); // Rasterize the slab into the front, normal, and flag images
+        computeProspect(r_capture); // Scan front image and generate geo pixels
+        computeAir();
+    }
+
+    void CPUBackend::saveCheckpoint(SweepCheckpoint & r_checkpoint) const {
+        r_checkpoint.airPixels = m_airPixels; // The previous slice's, as `step` swaps them in
+        r_checkpoint.turb = m_turb;
+        r_checkpoint.shad = m_shad;
+        r_checkpoint.results = m_results;
+        r_checkpoint.subModelResults = m_subModelResults;
+        r_checkpoint.stats = m_stats;
+    }
+
+    void CPUBackend::restoreCheckpoint(const SweepCheckpoint & checkpoint) {
+        m_airPixels = checkpoint.airPixels;
+        m_turb = checkpoint.turb;
+        m_shad = checkpoint.shad;
+        m_results = checkpoint.results;
+        m_subModelResults = checkpoint.subModelResults;
+        m_stats = checkpoint.stats;
+    }
+
+    void CPUBackend::rasterize(const Constants & constants, const Model & model, const mat4 & modelMat, const mat3 & normalMat) {
+        m_constants = constants;
+        renderGeometry(model, modelMat, normalMat);
+    }
+
+    void CPUBackend::replay(const Constants & constants, const GeometryCacheEntry & cache) {
+        m_constants = constants;
+
+        std::swap(m_airPixels, m_prevAirPixels);
+        m_airPixels.clear();
+
+        m_pool.parallelFor(m_texSize.y, [&](int rowBegin, int rowEnd, int /*chunkI*/) {
+            clearFront(rowBegin, rowEnd);
+        });
+        int start(cache.sliceStarts[m_constants.slice]), end(cache.sliceStarts[m_constants.slice + 1]);
+        computeScatter(cache.pixels.data() + start, end - start); // Restore the front and normal images, wind shadow, and geo pixels
+        m_results[m_constants.slice].drag = cache.results[m_constants.slice].drag;
+        m_results[m_constants.slice].torq = cache.results[m_constants.slice].torq;
+        computeAir();
+    }
+
+    void CPUBackend::computeAir() {
+        if (k_doTurbulence) m_prevTurb = m_turb;
+        computeDraw(); // Draw any existing air pixels to the front image and save their indices in the flag image
+        if (k_doSearchSkipping) computeDistance(); // Find how far each pixel is clear of geometry, air, and turbulence, for the searches to skip
+        computeOutline(); // Map air pixels to geometry, and generate new air pixels
+        computeMove(); // Calculate lift/drag and move any existing air pixels in relation to the geometry
+
+        m_results[m_constants.slice].geoCount = m_geoCount;
+        m_results[m_constants.slice].airCount = m_airCount;
+
+        SliceStats & stats(m_stats[m_constants.slice]);
+        stats.geoCount = m_geoCount;
+        stats.airCount = m_airCount;
+        stats.geoOverflow = glm::max(m_geoCount - m_maxGeoPixels, 0);
+        stats.airOverflow = glm::max(m_airCount - m_maxAirPixels, 0);
+    }
+
+    void CPUBackend::renderGeometry(const Model & model, const mat4 & modelMat, const mat3 & normalMat) {
+        float zNear(m_constants.sliceZ), zFar(m_constants.sliceZ - m_constants.sliceSize);
+
+        // Clip every triangle to the slab, then bring them into tex space
+        m_clipper.clip(model, modelMat, normalMat, zNear, zFar);
+        m_polygons = m_clipper.polygons();
+        for (SlabPolygon & polygon : m_polygons) {
+            for (int i(0); i < polygon.count; ++i) {
+                vec2 texPos(windToTex(vec2(polygon.verts[i].pos)));
+                polygon.verts[i].pos.x = texPos.x;
+                polygon.verts[i].pos.y = texPos.y;
+            }
+        }
+
+        // Rasterize, with each thread owning a band of rows. Rows past those in use are only cleared, as the viewport would
+        m_pool.parallelFor(m_texSize.y, [&](int rowBegin, int rowEnd, int /*chunkI*/) {
+            clearFront(rowBegin, rowEnd);
+            std::fill(m_depth.begin() + rowBegin * m_texSize.x, m_depth.begin() + rowEnd * m_texSize.x, zFar);
+            rowEnd = glm::min(rowEnd, m_constants.texSize.y);
+
+            // Outlines first, then fill, same as the two `glPolygonMode` draws. As with GL's edge flags, edges made by
+            // clipping aren't outlined
+            for (const SlabPolygon & polygon : m_polygons) {
+                for (int i(0); i < polygon.count; ++i) {
+                    if ((polygon.clipEdges >> i) & 1) continue;
+                    rasterizeLine(polygon.verts[i], polygon.verts[(i + 1) % polygon.count], polygon, rowBegin, rowEnd);
+                }
+            }
+            for (const SlabPolygon & polygon : m_polygons) {
+                for (int i(2); i < polygon.count; ++i) {
+                    rasterizeTriangle(polygon.verts[0], polygon.verts[i - 1], polygon.verts[i], polygon, rowBegin, rowEnd);
+                }
+            }
+        });
+    }
+
+    void CPUBackend::clearFront(int rowBegin, int rowEnd) {
+        int texelBegin(rowBegin * m_texSize.x), texelEnd(rowEnd * m_texSize.x);
+        std::fill(m_front.begin() + texelBegin, m_front.begin() + texelEnd, FrontTexel{});
+        std::fill(m_norm.begin() + texelBegin, m_norm.begin() + texelEnd, vec3());
+        std::fill(m_index.begin() + texelBegin, m_index.begin() + texelEnd, 0u);
+        std::fill(m_subModel.begin() + texelBegin, m_subModel.begin() + texelEnd, 0u);
+        std::fill(m_flag.begin() + texelBegin, m_flag.begin() + texelEnd, 0);
+    }
+
+    void CPUBackend::rasterizeLine(const SlabVertex & v0, const SlabVertex & v1, const SlabPolygon & polygon, int rowBegin, int rowEnd) {
+        vec2 p0(v0.pos), p1(v1.pos);
+        vec2 d(p1 - p0);
+        if (d == vec2()) {
+            return;
+        }
+
+        // Each column of an x major line may have a fragment in the row the line crosses its center, and likewise for
+        // each row of a y major line. Attributes are those where the line crosses. The ends may reach a pixel past
+        // either way, as the line's diamonds stick out of them
+        if (glm::abs(d.x) >= glm::abs(d.y)) {
+            int xBegin(glm::max(int(std::floor(glm::min(p0.x, p1.x))) - 1, 0));
+            int xEnd(glm::min(int(std::floor(glm::max(p0.x, p1.x))) + 2, m_constants.texSize.x));
+            for (int x(xBegin); x < xEnd; ++x) {
+                float t((float(x) + 0.5f - p0.x) / d.x);
+                vec3 pos(glm::mix(v0.pos, v1.pos, t));
+                int y(int(std::floor(double(p0.y) + (x + 0.5 - double(p0.x) + k_linePerturbation) * double(d.y) / double(d.x) - k_linePerturbation * k_linePerturbation)));
+                if (y >= rowBegin && y < rowEnd && isLineFragment(p0, p1, x, y)) {
+                    writeFragment(x, y, vec2(pos), pos.z, glm::mix(v0.norm, v1.norm, t), polygon);
+                }
+            }
+        }
+        else {
+            int yBegin(glm::max(int(std::floor(glm::min(p0.y, p1.y))) - 1, rowBegin));
+            int yEnd(glm::min(int(std::floor(glm::max(p0.y, p1.y))) + 2, rowEnd));
+            for (int y(yBegin); y < yEnd; ++y) {
+                float t((float(y) + 0.5f - p0.y) / d.y);
+                vec3 pos(glm::mix(v0.pos, v1.pos, t));
+                int x(int(std::floor(double(p0.x) + (y + 0.5 - double(p0.y) + k_linePerturbation * k_linePerturbation) * double(d.x) / double(d.y) - k_linePerturbation)));
+                if (x >= 0 && x < m_constants.texSize.x && isLineFragment(p0, p1, x, y)) {
+                    writeFragment(x, y, vec2(pos), pos.z, glm::mix(v0.norm, v1.norm, t), polygon);
+                }
+            }
+        }
+    }
+
+    void CPUBackend::rasterizeTriangle(const SlabVertex & v0, const SlabVertex & v1, const SlabVertex & v2, const SlabPolygon & polygon, int rowBegin, int rowEnd) {
+        vec2 p0(v0.pos), p1(v1.pos), p2(v2.pos);
+        float area(edgeFunction(p0, p1, p2));
+        if (area == 0.0f) {
+            return;
+        }
+        // Make counter-clockwise
+        const SlabVertex * a(&v0), * b(&v1), * c(&v2);
+        if (area < 0.0f) {
+            std::swap(b, c);
+            std::swap(p1, p2);
+            area = -area;
+        }
+        bool topLeft0(isTopLeft(p1, p2)), topLeft1(isTopLeft(p2, p0)), topLeft2(isTopLeft(p0, p1));
+
+        int xBegin(glm::max(int(std::ceil(glm::min(p0.x, glm::min(p1.x, p2.x)) - 0.5f)), 0));
+        int xEnd(glm::min(int(std::ceil(glm::max(p0.x, glm::max(p1.x, p2.x)) - 0.5f)), m_constants.texSize.x));
+        int yBegin(glm::max(int(std::ceil(glm::min(p0.y, glm::min(p1.y, p2.y)) - 0.5f)), rowBegin));
+        int yEnd(glm::min(int(std::ceil(glm::max(p0.y, glm::max(p1.y, p2.y)) - 0.5f)), rowEnd));
+
+        float invArea(1.0f / area);
+        auto shade([&](int x, int y, float w0, float w1, float w2) {
+            w0 *= invArea; w1 *= invArea; w2 *= invArea;
+            float z(w0 * a->pos.z + w1 * b->pos.z + w2 * c->pos.z);
+            vec3 norm(w0 * a->norm + w1 * b->norm + w2 * c->norm);
+            writeFragment(x, y, vec2(float(x) + 0.5f, float(y) + 0.5f), z, norm, polygon);
+        });
+
+        // Each edge function is `row - slope * (x - origin)`, the same operations as `edgeFunction`, so the SIMD and
+        // scalar paths agree exactly. Pixels on an edge are only covered if it's a top or left edge
+        float slope0(p2.y - p1.y), slope1(p0.y - p2.y), slope2(p1.y - p0.y);
+        for (int y(yBegin); y < yEnd; ++y) {
+            float py(float(y) + 0.5f);
+            float row0((p2.x - p1.x) * (py - p1.y)), row1((p0.x - p2.x) * (py - p2.y)), row2((p1.x - p0.x) * (py - p0.y));
+            int x(xBegin);
+
+#ifdef RLD_SSE2
+            // Four pixels at a time
+            const __m128i laneOffsets(_mm_setr_epi32(0, 1, 2, 3));
+            const __m128 zero(_mm_setzero_ps()), half(_mm_set1_ps(0.5f));
+            for (; x + 4 <= xEnd; x += 4) {
+                __m128 px(_mm_add_ps(_mm_cvtepi32_ps(_mm_add_epi32(_mm_set1_epi32(x), laneOffsets)), half));
+                __m128 w0(_mm_sub_ps(_mm_set1_ps(row0), _mm_mul_ps(_mm_set1_ps(slope0), _mm_sub_ps(px, _mm_set1_ps(p1.x)))));
+                __m128 w1(_mm_sub_ps(_mm_set1_ps(row1), _mm_mul_ps(_mm_set1_ps(slope1), _mm_sub_ps(px, _mm_set1_ps(p2.x)))));
+                __m128 w2(_mm_sub_ps(_mm_set1_ps(row2), _mm_mul_ps(_mm_set1_ps(slope2), _mm_sub_ps(px, _mm_set1_ps(p0.x)))));
+                __m128 isIn0(topLeft0 ? _mm_cmpge_ps(w0, zero) : _mm_cmpgt_ps(w0, zero));
+                __m128 isIn1(topLeft1 ? _mm_cmpge_ps(w1, zero) : _mm_cmpgt_ps(w1, zero));
+                __m128 isIn2(topLeft2 ? _mm_cmpge_ps(w2, zero) : _mm_cmpgt_ps(w2, zero));
+                int mask(_mm_movemask_ps(_mm_and_ps(_mm_and_ps(isIn0, isIn1), isIn2)));
+                if (!mask) {
+                    continue;
+                }
+                alignas(16) float ws0[4], ws1[4], ws2[4];
+                _mm_store_ps(ws0, w0);
+                _mm_store_ps(ws1, w1);
+                _mm_store_ps(ws2, w2);
+                for (int i(0); i < 4; ++i) {
+                    if (mask & (1 << i)) shade(x + i, y, ws0[i], ws1[i], ws2[i]);
+                }
+            }
+#endif
+
+            for (; x < xEnd; ++x) {
+                float px(float(x) + 0.5f);
+                float w0(row0 - slope0 * (px - p1.x)), w1(row1 - slope1 * (px - p2.x)), w2(row2 - slope2 * (px - p0.x));
+                bool isIn0(topLeft0 ? w0 >= 0.0f : w0 > 0.0f);
+                bool isIn1(topLeft1 ? w1 >= 0.0f : w1 > 0.0f);
+                bool isIn2(topLeft2 ? w2 >= 0.0f : w2 > 0.0f);
+                if (isIn0 && isIn1 && isIn2) {
+                    shade(x, y, w0, w1, w2);
+                }
+            }
+        }
+    }
+
+    void CPUBackend::writeFragment(int x, int y, const vec2 & texPos, float z, const vec3 & norm, const SlabPolygon & polygon) {
+        // Completely ignore any zero-normal geometry
+        if (norm == vec3()) {
+            return;
+        }
+
+        // Mirrors `GL_LESS` depth test, where greater wind z is nearer. A line's ends can reach past the slab, and
+        // their depth is clamped to it, as GL clamps to the depth range
+        z = glm::clamp(z, m_constants.sliceZ - m_constants.sliceSize, m_constants.sliceZ);
+        int texelI(y * m_texSize.x + x);
+        if (!(z > m_depth[texelI])) {
+            return;
+        }
+        m_depth[texelI] = z;
+
+        // Using the sub-pixel channels to store wind position
+        vec2 subPixelPos(glm::clamp(glm::round((texPos - vec2(x, y)) * 255.0f), 0.0f, 255.0f));
+        m_front[texelI] = FrontTexel{ u08(k_geoBit), u08(subPixelPos.x), u08(subPixelPos.y), 0 };
+        m_norm[texelI] = quantizeSnorm16(glm::normalize(norm));
+        m_index[texelI] = u32(polygon.triI + 1);
+        m_subModel[texelI] = u32(polygon.subModelI + 1);
+    }
+
+    // Adds the drag on every polygon of the slab from its area, so it doesn't depend on how many pixels it happens to
+    // cover. Follows the same rules as the pixels, judging the wind shadow at each triangle's center
+    void CPUBackend::computeExactDrag() {
+        const Constants & c(m_constants);
+        float dragFactor(0.5f * k_airDensity * c.windSpeed * c.windSpeed * c.pixelSize * c.pixelSize * c.dragC); // Per unit of tex space area
+        int polygonCount(int(m_polygons.size()));
+        int chunks(m_pool.chunkCount(polygonCount));
+        if (int(m_chunkForces.size()) < chunks) {
+            m_chunkForces.resize(chunks);
+            m_chunkTorqs.resize(chunks);
+        }
+        clearChunkSubModelResults(chunks);
+
+        m_pool.parallelFor(polygonCount, [&](int begin, int end, int chunkI) {
+            vec3 drag, torq;
+            for (int polygonI(begin); polygonI < end; ++polygonI) {
+                const SlabPolygon & polygon(m_polygons[polygonI]);
+
+                // Only the part over the core counts. Each clip can add a vertex
+                SlabVertex verts[9], temp[9];
+                int count(clipPolygon(polygon.verts, polygon.count, 0, float(c.coreMin.x), 1.0f, temp));
+                count = clipPolygon(temp, count, 0, float(c.coreMax.x), -1.0f, verts);
+                count = clipPolygon(verts, count, 1, float(c.coreMin.y), 1.0f, temp);
+                count = clipPolygon(temp, count, 1, float(c.coreMax.y), -1.0f, verts);
+
+                for (int i(2); i < count; ++i) {
+                    const SlabVertex & v0(verts[0]), & v1(verts[i - 1]), & v2(verts[i]);
+                    float area(0.5f * glm::abs(edgeFunction(vec2(v0.pos), vec2(v1.pos), vec2(v2.pos))));
+                    vec3 normal(safeNormalize(v0.norm + v1.norm + v2.norm));
+                    vec2 center((vec2(v0.pos) + vec2(v1.pos) + vec2(v2.pos)) * (1.0f / 3.0f));
+                    // Surfaces facing away cast wind shadow instead
+                    if ((k_doWindShadow && normal.z < 0.0f) || isTexInShadow(center)) {
+                        continue;
+                    }
+                    vec3 triDrag(-normal * (dragFactor * area * normal.z));
+                    vec3 triTorq(glm::cross(vec3(texToWind(center), c.sliceZ), triDrag));
+                    drag += triDrag;
+                    torq += triTorq;
+                    if (c.subModelCount) {
+                        Result & subModelResult(m_chunkSubModelResults[chunkI][polygon.subModelI]);
+                        subModelResult.drag += triDrag;
+                        subModelResult.torq += triTorq;
+                    }
+                }
+            }
+            m_chunkForces[chunkI] = drag;
+            m_chunkTorqs[chunkI] = torq;
+        });
+
+        Result & result(m_results[c.slice]);
+        for (int chunkI(0); chunkI < chunks; ++chunkI) {
+            result.drag += m_chunkForces[chunkI];
+            result.torq += m_chunkTorqs[chunkI];
+        }
+        gatherChunkSubModelResults(chunks);
+    }
+
+    void CPUBackend::computeProspect(GeometryCacheEntry * r_capture) {
+        const Constants & c(m_constants);
+        if (m_isExactDrag) computeExactDrag(); // Before any wind shadow of this slice is cast
+        float dragFactor(0.5f * k_airDensity * c.windSpeed * c.windSpeed * c.pixelSize * c.pixelSize * c.dragC);
+        u08 shadVal(u08(std::round((c.windframeDepth * 0.5f - c.sliceZ) / c.windframeDepth * 255.0f)));
+
+        int chunks(m_pool.chunkCount(m_texSize.y));
+        clearChunkSubModelResults(chunks);
+        m_pool.parallelFor(m_texSize.y, [&](int rowBegin, int rowEnd, int chunkI) {
+            std::vector<GeoPixel> & geoPixels(m_chunkGeoPixels[chunkI]);
+            std::vector<ShadWrite> & shadWrites(m_chunkShadWrites[chunkI]);
+            std::vector<CachedPixel> & cachedPixels(m_chunkCachedPixels[chunkI]);
+            geoPixels.clear();
+            shadWrites.clear();
+            cachedPixels.clear();
+            vec3 drag, torq;
+
+            for (int y(rowBegin); y < rowEnd; ++y) {
+                for (int x(0); x < c.texSize.x; ++x) {
+                    ivec2 texCoord(x, y);
+                    const FrontTexel & color(m_front[y * m_texSize.x + x]);
+                    // If not geometry, ignore
+                    if (!(color.flags & k_geoBit)) {
+                        continue;
+                    }
+
+                    vec2 geoWindPos(texToWind(vec2(texCoord) + vec2(color.subX, color.subY) / 255.0f));
+                    const vec3 & geoNormal(m_norm[y * m_texSize.x + x]);
+
+                    // Set wind shadow, which is applied after the scan so every pixel sees the same state
+                    if (k_doWindShadow && geoNormal.z < 0.0f) {
+                        shadWrites.push_back(ShadWrite{ (y / 4) * m_quarterSize.x + x / 4, shadVal });
+                    }
+                    // Calculate drag and torque
+                    else if (!m_isExactDrag && !isTexInShadow(vec2(texCoord) + 0.5f) && isInCore(texCoord)) {
+                        vec3 pixelDrag(-geoNormal * (dragFactor * geoNormal.z));
+                        vec3 pixelTorq(glm::cross(vec3(geoWindPos, c.sliceZ), pixelDrag));
+                        drag += pixelDrag;
+                        torq += pixelTorq;
+                        if (c.subModelCount) {
+                            Result & subModelResult(m_chunkSubModelResults[chunkI][m_subModel[y * m_texSize.x + x] - 1]);
+                            subModelResult.drag += pixelDrag;
+                            subModelResult.torq += pixelTorq;
+                        }
+                    }
+
+                    // Check if we're on leading edge
+                    ivec2 nextTexCoord(mirrorTexCoord(texCoord + getPixelDelta(vec2(geoNormal))));
+                    int edge(!isInTexture(nextTexCoord) || !(m_front[nextTexCoord.y * m_texSize.x + nextTexCoord.x].flags & k_geoBit));
+
+                    if (r_capture) {
+                        cachedPixels.push_back(CachedPixel{
+                            u32(x) | u32(y) << 16,
+                            u32(color.subX) | u32(color.subY) << 8 | u32(edge) << 16,
+                            glm::packSnorm2x16(vec2(geoNormal)),
+                            glm::packSnorm2x16(vec2(geoNormal.z, 0.0f))
+                        });
+                    }
+
+                    if (edge) {
+                        geoPixels.push_back(GeoPixel{ geoWindPos, texCoord, geoNormal, edge });
+                    }
+                }
+            }
+
+            m_chunkForces[chunkI] = drag;
+            m_chunkTorqs[chunkI] = torq;
+        });
+
+        // Gather in chunk order, which is raster order
+        m_geoPixels.clear();
+        m_geoCount = 0;
+        Result & result(m_results[c.slice]);
+        if (r_capture) r_capture->sliceStarts[c.slice] = int(r_capture->pixels.size());
+        for (int chunkI(0); chunkI < chunks; ++chunkI) {
+            const std::vector<GeoPixel> & geoPixels(m_chunkGeoPixels[chunkI]);
+            m_geoCount += int(geoPixels.size());
+            int n(glm::min(int(geoPixels.size()), m_maxGeoPixels - int(m_geoPixels.size())));
+            m_geoPixels.insert(m_geoPixels.end(), geoPixels.begin(), geoPixels.begin() + n);
+            for (const ShadWrite & write : m_chunkShadWrites[chunkI]) {
+                m_shad[write.texelI] = write.val;
+            }
+            result.drag += m_chunkForces[chunkI];
+            result.torq += m_chunkTorqs[chunkI];
+            if (r_capture) {
+                r_capture->pixels.insert(r_capture->pixels.end(), m_chunkCachedPixels[chunkI].begin(), m_chunkCachedPixels[chunkI].end());
+            }
+        }
+        if (r_capture) {
+            r_capture->sliceStarts[c.slice + 1] = int(r_capture->pixels.size());
+            r_capture->results[c.slice] = result;
+        }
+        gatherChunkSubModelResults(chunks);
+    }
+
+    void CPUBackend::computeScatter(const CachedPixel * pixels, int pixelCount) {
+        u08 shadVal(u08(std::round((m_constants.windframeDepth * 0.5f - m_constants.sliceZ) / m_constants.windframeDepth * 255.0f)));
+
+        int chunks(m_pool.chunkCount(pixelCount));
+        m_pool.parallelFor(pixelCount, [&](int begin, int end, int chunkI) {
+            std::vector<GeoPixel> & geoPixels(m_chunkGeoPixels[chunkI]);
+            std::vector<ShadWrite> & shadWrites(m_chunkShadWrites[chunkI]);
+            geoPixels.clear();
+            shadWrites.clear();
+
+            for (int i(begin); i < end; ++i) {
+                const CachedPixel & pixel(pixels[i]);
+                ivec2 texCoord(pixel.texCoord & 0xFFFF, pixel.texCoord >> 16);
+                u08 subX(u08(pixel.color)), subY(u08(pixel.color >> 8));
+                int edge(int(pixel.color >> 16));
+                vec3 geoNormal(glm::unpackSnorm2x16(pixel.normalXY), glm::unpackSnorm2x16(pixel.normalZ).x);
+
+                int texelI(texCoord.y * m_texSize.x + texCoord.x);
+                m_front[texelI] = FrontTexel{ u08(k_geoBit), subX, subY, 0 };
+                m_norm[texelI] = geoNormal;
+
+                if (k_doWindShadow && geoNormal.z < 0.0f) {
+                    shadWrites.push_back(ShadWrite{ (texCoord.y / 4) * m_quarterSize.x + texCoord.x / 4, shadVal });
+                }
+
+                if (edge) {
+                    vec2 geoWindPos(texToWind(vec2(texCoord) + vec2(subX, subY) / 255.0f));
+                    geoPixels.push_back(GeoPixel{ geoWindPos, texCoord, geoNormal, edge });
+                }
+            }
+        });
+
+        // Gather in chunk order, which is the order the pixels were captured in
+        m_geoPixels.clear();
+        m_geoCount = 0;
+        for (int chunkI(0); chunkI < chunks; ++chunkI) {
+            const std::vector<GeoPixel> & geoPixels(m_chunkGeoPixels[chunkI]);
+            m_geoCount += int(geoPixels.size());
+            int n(glm::min(int(geoPixels.size()), m_maxGeoPixels - int(m_geoPixels.size())));
+            m_geoPixels.insert(m_geoPixels.end(), geoPixels.begin(), geoPixels.begin() + n);
+            for (const ShadWrite & write : m_chunkShadWrites[chunkI]) {
+                m_shad[write.texelI] = write.val;
+            }
+        }
+    }
+
+    void CPUBackend::computeDraw() {
+        int prevAirCount(int(m_prevAirPixels.size()));
+        int chunks(m_pool.chunkCount(prevAirCount));
+
+        // Find where each air pixel lands
+        m_pool.parallelFor(prevAirCount, [&](int begin, int end, int chunkI) {
+            std::vector<AirPixel> & airs(m_chunkAirs[chunkI]);
+            std::vector<ivec2> & airTexCoords(m_chunkAirTexCoords[chunkI]);
+            airs.clear();
+            airTexCoords.clear();
+
+            for (int prevAirI(begin); prevAirI < end; ++prevAirI) {
+                AirPixel air(m_prevAirPixels[prevAirI]);
+                ivec2 airTexCoord(windToTex(air.windPos));
+
+                // Check if in texture
+                if (!isInTexture(airTexCoord)) {
+                    continue;
+                }
+
+                // If in geometry, follow the geo normals to find the edge
+                if (m_front[airTexCoord.y * m_texSize.x + airTexCoord.x].flags & k_geoBit) {
+                    ivec2 pixel(airTexCoord);
+                    int steps(0);
+                    bool isLost(false);
+                    while (true) {
+                        // Same as `draw.comp`, the normal is sampled at the air's original pixel
+                        const vec3 & geoNormal(m_norm[airTexCoord.y * m_texSize.x + airTexCoord.x]);
+                        if (glm::abs(geoNormal.z) > k_maxNormalZ) {
+                            isLost = true;
+                            break;
+                        }
+                        ivec2 nextPixel(pixel + getPixelDelta(vec2(geoNormal)));
+
+                        // We found the edge, move air to it
+                        if (!isInTexture(nextPixel) || !(m_front[nextPixel.y * m_texSize.x + nextPixel.x].flags & k_geoBit)) {
+                            airTexCoord = pixel;
+
+                            // Set air to same position as geometry
+                            const FrontTexel & color(m_front[airTexCoord.y * m_texSize.x + airTexCoord.x]);
+                            air.windPos = texToWind(vec2(airTexCoord) + vec2(color.subX, color.subY) / 255.0f);
+
+                            vec2 norm(glm::normalize(vec2(geoNormal)));
+                            if (geoNormal.z > 0.0f) {
+                                air.velocity = glm::max(glm::dot(air.velocity, norm), geoNormal.z * m_constants.windSpeed) * norm;
+                            }
+                            else {
+                                air.velocity = geoNormal.z * m_constants.windSpeed * norm;
+                            }
+
+                            air.backforce = vec2();
+                            air.turbulence = vec2();
+                            break;
+                        }
+
+                        // If air "inside" geometry, get rid of it, unless it's on the very edge
+                        if (geoNormal.z < 0.0f || ++steps >= k_maxEdgeSeekSteps) {
+                            isLost = true;
+                            break;
+                        }
+
+                        pixel = nextPixel;
+                    }
+                    if (isLost) {
+                        continue;
+                    }
+                }
+
+                airs.push_back(air);
+                airTexCoords.push_back(airTexCoord);
+            }
+        });
+
+        // Claim pixels in order. The first air pixel to land on a pixel keeps it
+        m_airCount = 0;
+        for (int chunkI(0); chunkI < chunks; ++chunkI) {
+            const std::vector<AirPixel> & airs(m_chunkAirs[chunkI]);
+            const std::vector<ivec2> & airTexCoords(m_chunkAirTexCoords[chunkI]);
+            for (size_t i(0); i < airs.size(); ++i) {
+                int texelI(airTexCoords[i].y * m_texSize.x + airTexCoords[i].x);
+                // Air already exists at pixel, or would have were there room
+                if ((m_front[texelI].flags & k_airBit) || m_flag[texelI] < 0) {
+                    continue;
+                }
+                // Keeps counting past capacity so overflow can be detected
+                ++m_airCount;
+                if (int(m_airPixels.size()) >= m_maxAirPixels) {
+                    m_flag[texelI] = -1;
+                    continue;
+                }
+
+                int airI(int(m_airPixels.size()));
+                m_airPixels.push_back(airs[i]);
+                m_airGeoMap[airI] = 0; // This air pixel is not yet associated with any geometry
+                m_flag[texelI] = airI + 1;
+                m_front[texelI].flags |= k_airBit;
+            }
+        }
+    }
+
+    void CPUBackend::computeDistance() {
+        ivec2 texSize(m_constants.texSize);
+        int passes(distPassCount(m_constants.maxSearchDist / m_constants.pixelSize));
+        for (int pass(0); pass < passes; ++pass) {
+            std::swap(m_dist, m_prevDist);
+            m_pool.parallelFor(m_texSize.y, [&](int rowBegin, int rowEnd, int /*chunkI*/) {
+                for (int y(rowBegin); y < rowEnd; ++y) {
+                    for (int x(0); x < texSize.x; ++x) {
+                        int texelI(y * m_texSize.x + x);
+                        if (pass == 0) {
+                            m_dist[texelI] = u08(!isOccupied(ivec2(x, y)));
+                            continue;
+                        }
+
+                        u08 dist(m_prevDist[texelI]);
+                        if (dist == pass) {
+                            int radius(0);
+                            for (int passI(1); passI < pass; ++passI) radius = radius * 3 + 1;
+                            int jump(radius * 2 + 1);
+
+                            // Taps past the border are clamped, as the part of their square inside the texture is within the clamped one's
+                            bool isClear(true);
+                            for (int dy(-1); dy <= 1; ++dy) {
+                                for (int dx(-1); dx <= 1; ++dx) {
+                                    ivec2 tap(glm::clamp(ivec2(x + dx * jump, y + dy * jump), ivec2(0), texSize - 1));
+                                    isClear = isClear && m_prevDist[tap.y * m_texSize.x + tap.x] >= pass;
+                                }
+                            }
+                            if (isClear) ++dist;
+                        }
+                        m_dist[texelI] = dist;
+                    }
+                }
+            });
+        }
+    }
+
+    int CPUBackend::findAir(const vec2 & geoTexPos, const ivec2 & geoTexCoord, vec2 searchDir, std::vector<int> & r_turbAirs, std::vector<int> & r_turbWrites, int & r_searchSteps) const {
+        vec2 searchTexPos(geoTexPos);
+        ivec2 searchPixel(geoTexCoord);
+        vec2 corner(glm::step(vec2(), searchDir));
+        float totalDist(0.0f);
+
+        // Check for air on geometry
+        int texelI(searchPixel.y * m_texSize.x + searchPixel.x);
+        if ((m_front[texelI].flags & k_airBit) && m_flag[texelI] != 0) {
+            return m_flag[texelI] - 1;
+        }
+
+        // Search along line in searchDir
+        while (true) {
+            ++r_searchSteps;
+
+            // Jump over empty space
+            float skipDist(getSkipDist(searchPixel));
+            if (skipDist > 0.0f) {
+                searchTexPos += searchDir * skipDist;
+                searchPixel = ivec2(glm::floor(searchTexPos));
+                totalDist += texToWindDist(skipDist);
+                reflectSearch(searchTexPos, searchPixel, searchDir, corner);
+            }
+
+            vec2 delta(corner - (searchTexPos - vec2(searchPixel)));
+            vec2 dist(glm::abs(delta / searchDir));
+            if (dist.x < dist.y) {
+                searchTexPos += searchDir * dist.x;
+                searchPixel.x += int(glm::sign(searchDir.x));
+                totalDist += texToWindDist(dist.x);
+            }
+            else {
+                searchTexPos += searchDir * dist.y;
+                searchPixel.y += int(glm::sign(searchDir.y));
+                totalDist += texToWindDist(dist.y);
+            }
+            reflectSearch(searchTexPos, searchPixel, searchDir, corner);
+
+            if (totalDist > m_constants.maxSearchDist) {
+                return -1;
+            }
+
+            // If find turbulence, stop looking and mark turbulence half way between found turbulence and geometry
+            if (k_doTurbulence && isTexTurbulent(searchTexPos)) {
+                r_turbWrites.push_back(turbTexelI((geoTexPos + searchTexPos) * 0.5f));
+                return -2;
+            }
+
+            if (!isInTexture(searchPixel)) {
+                continue;
+            }
+            texelI = searchPixel.y * m_texSize.x + searchPixel.x;
+            u08 flags(m_front[texelI].flags);
+
+            if (flags & k_geoBit) { // we found a geo pixel
+                return -1;
+            }
+            if ((flags & k_airBit) && m_flag[texelI] != 0) { // we found an air pixel
+                int airI(m_flag[texelI] - 1);
+
+                // If past turbulence distance, set air as turbulent
+                if (k_doTurbulence && totalDist > m_constants.turbulenceDist) {
+                    r_turbAirs.push_back(airI);
+                    return -2;
+                }
+
+                return airI;
+            }
+        }
+    }
+
+    void CPUBackend::computeOutline() {
+        int geoCount(int(m_geoPixels.size()));
+        int chunks(m_pool.chunkCount(geoCount));
+
+        // Search phase. Nothing is written until every search is done
+        m_pool.parallelFor(geoCount, [&](int begin, int end, int chunkI) {
+            std::vector<ivec2> & airGeoMaps(m_chunkAirGeoMaps[chunkI]);
+            std::vector<int> & spawns(m_chunkSpawns[chunkI]);
+            std::vector<int> & turbAirs(m_chunkTurbAirs[chunkI]);
+            std::vector<int> & turbWrites(m_chunkTurbWrites[chunkI]);
+            SliceStats & stats(m_chunkStats[chunkI]);
+            airGeoMaps.clear();
+            spawns.clear();
+            turbAirs.clear();
+            turbWrites.clear();
+            stats = SliceStats{};
+
+            for (int geoI(begin); geoI < end; ++geoI) {
+                const GeoPixel & geo(m_geoPixels[geoI]);
+                vec2 geoTexPos(glm::clamp(windToTex(geo.windPos), vec2(geo.texCoord), vec2(geo.texCoord + 1))); // necessary for edge cases
+
+                bool shouldSpawn(geo.normal.z >= k_minNormalZ && geo.normal.z <= k_maxNormalZ);
+                bool shouldSearch(glm::abs(geo.normal.z) <= k_maxNormalZ);
+
+                // If geo is in turbulence, forget it
+                if (k_doTurbulence && isTexTurbulent(geoTexPos)) {
+                    shouldSearch = false;
+                    shouldSpawn = false;
+                }
+
+                // Look for existing air pixel
+                if (shouldSearch) {
+                    int res(findAir(geoTexPos, geo.texCoord, glm::normalize(vec2(geo.normal)), turbAirs, turbWrites, stats.searchSteps));
+                    if (res == -2) ++stats.turbulenceHits;
+                    shouldSpawn = shouldSpawn && res == -1;
+                    if (res >= 0) airGeoMaps.push_back(ivec2(res, geoI + 1));
+                }
+
+                if (shouldSpawn) spawns.push_back(geoI);
+            }
+        });
+
+        for (int chunkI(0); chunkI < chunks; ++chunkI) {
+            for (const ivec2 & airGeoMap : m_chunkAirGeoMaps[chunkI]) m_airGeoMap[airGeoMap.x] = airGeoMap.y;
+            for (int airI : m_chunkTurbAirs[chunkI]) m_airPixels[airI].turbulence.x = 1.0f;
+            for (int texelI : m_chunkTurbWrites[chunkI]) m_turb[texelI] = 255;
+            m_stats[m_constants.slice].searchSteps += m_chunkStats[chunkI].searchSteps;
+            m_stats[m_constants.slice].turbulenceHits += m_chunkStats[chunkI].turbulenceHits;
+        }
+
+        // Overwrite flag image with geometry index
+        for (int geoI(0); geoI < geoCount; ++geoI) {
+            const ivec2 & texCoord(m_geoPixels[geoI].texCoord);
+            m_flag[texCoord.y * m_texSize.x + texCoord.x] = geoI + 1;
+        }
+
+        // Make new air pixels, in geo order
+        for (int chunkI(0); chunkI < chunks; ++chunkI) {
+            for (int geoI : m_chunkSpawns[chunkI]) {
+                ++m_airCount;
+                if (int(m_airPixels.size()) >= m_maxAirPixels) {
+                    continue;
+                }
+
+                const GeoPixel & geo(m_geoPixels[geoI]);
+                m_airGeoMap[m_airPixels.size()] = geoI + 1;
+
+                vec3 refl(glm::reflect(vec3(0.0f, 0.0f, -1.0f), geo.normal));
+                vec2 airVelocity(vec2(refl) * m_constants.windSpeed * m_constants.initVelC);
+                m_airPixels.push_back(AirPixel{ geo.windPos, airVelocity, vec2(), vec2() });
+            }
+        }
+    }
+
+    void CPUBackend::computeMove() {
+        const Constants & c(m_constants);
+        int airCount(int(m_airPixels.size()));
+        int geoCount(int(m_geoPixels.size()));
+        int chunks(m_pool.chunkCount(airCount));
+        clearChunkSubModelResults(chunks);
+
+        m_pool.parallelFor(airCount, [&](int begin, int end, int chunkI) {
+            std::vector<int> & turbWrites(m_chunkTurbWrites[chunkI]);
+            SliceStats & stats(m_chunkStats[chunkI]);
+            turbWrites.clear();
+            stats = SliceStats{};
+            vec3 totalLift, totalTorq;
+
+            for (int airI(begin); airI < end; ++airI) {
+                AirPixel & air(m_airPixels[airI]);
+                vec2 airWindPos(air.windPos);
+                vec2 airVelocity(air.velocity);
+                float airTurbulence(air.turbulence.x);
+                int geoI(m_airGeoMap[airI]);
+                bool isGeo(false);
+                if (geoI > 0) { --geoI; isGeo = true; }
+                vec2 airTexPos(windToTex(airWindPos));
+
+                bool shouldSearch(!isGeo);
+
+                // Check if air pixel is within turbulence
+                if (k_doTurbulence && isTexTurbulent(airTexPos)) {
+                    airTurbulence = 1.0f;
+                }
+                // If air pixel is turbulent, write turbulence
+                if (k_doTurbulence && airTurbulence > 0.0f) {
+                    turbWrites.push_back(turbTexelI(airTexPos));
+                    shouldSearch = false;
+                }
+
+                // If not turbulent and no geo found for this air, search for geo
+                vec2 searchDir(air.backforce);
+                if (shouldSearch && searchDir != vec2()) {
+                    vec2 searchTexPos(airTexPos);
+                    ivec2 searchPixel(searchTexPos);
+                    searchDir = glm::normalize(searchDir);
+                    vec2 corner(glm::step(vec2(), searchDir));
+                    float totalDist(0.0f);
+                    while (true) {
+                        ++stats.searchSteps;
+
+                        // Jump over empty space
+                        float skipDist(getSkipDist(searchPixel));
+                        if (skipDist > 0.0f) {
+                            searchTexPos += searchDir * skipDist;
+                            searchPixel = ivec2(glm::floor(searchTexPos));
+                            totalDist += texToWindDist(skipDist);
+                            reflectSearch(searchTexPos, searchPixel, searchDir, corner);
+                        }
+
+                        vec2 delta(corner - (searchTexPos - vec2(searchPixel)));
+                        vec2 dist(glm::abs(delta / searchDir));
+                        if (dist.x < dist.y) {
+                            searchTexPos += searchDir * dist.x;
+                            searchPixel.x += int(glm::sign(searchDir.x));
+                            totalDist += texToWindDist(dist.x);
+                        }
+                        else {
+                            searchTexPos += searchDir * dist.y;
+                            searchPixel.y += int(glm::sign(searchDir.y));
+                            totalDist += texToWindDist(dist.y);
+                        }
+                        reflectSearch(searchTexPos, searchPixel, searchDir, corner);
+
+                        if (totalDist > c.maxSearchDist) {
+                            break;
+                        }
+
+                        // If find turbulence, stop looking, mark air as turbulent, and write turbulence at air and half way
+                        if (k_doTurbulence && isTexTurbulent(searchTexPos)) {
+                            airTurbulence = 1.0f;
+                            turbWrites.push_back(turbTexelI(airTexPos));
+                            turbWrites.push_back(turbTexelI((airTexPos + searchTexPos) * 0.5f));
+                            ++stats.turbulenceHits;
+                            break;
+                        }
+
+                        if (!isInTexture(searchPixel)) {
+                            continue;
+                        }
+                        int texelI(searchPixel.y * m_texSize.x + searchPixel.x);
+
+                        if (m_front[texelI].flags & k_geoBit) { // we found a geo pixel
+                            int foundGeoI(m_flag[texelI]);
+                            if (foundGeoI > 0 && foundGeoI <= geoCount) {
+                                geoI = foundGeoI - 1;
+                                isGeo = true;
+
+                                m_airGeoMap[airI] = geoI + 1;
+
+                                if (k_doTurbulence && totalDist > c.turbulenceDist) {
+                                    airTurbulence = 1.0f;
+                                    turbWrites.push_back(turbTexelI(airTexPos));
+                                    turbWrites.push_back(turbTexelI((airTexPos + searchTexPos) * 0.5f));
+                                    ++stats.turbulenceHits;
+                                }
+                            }
+
+                            break;
+                        }
+                    }
+                }
+
+                vec2 backforce;
+
+                // For the associated geo pixel, update backforce, lift, and drag
+                if (isGeo && geoI < geoCount) {
+                    vec2 geoWindPos(m_geoPixels[geoI].windPos);
+                    vec3 geoNormal(m_geoPixels[geoI].normal);
+                    float dist(glm::distance(geoWindPos, airWindPos));
+                    float dirSign(glm::sign(glm::dot(vec2(geoNormal), airWindPos - geoWindPos))); // 1 if air is in front of geometry, -1 if behind
+
+                    float area(c.pixelSize * c.sliceSize * (1.0f - glm::abs(glm::dot(geoNormal, glm::normalize(vec3(airVelocity, -c.windSpeed))))));
+
+                    // Calculate backforce
+                    backforce = safeNormalize(-vec2(geoNormal)) * dirSign * dist * c.backforceC;
+
+                    // Calculate lift
+                    float liftFactor(0.5f * k_airDensity * c.windSpeed * c.windSpeed * area);
+                    liftFactor *= dist / c.turbulenceDist;
+                    liftFactor *= c.liftC;
+                    if (airTurbulence > 0.0f) liftFactor = 0.0f;
+                    vec3 lift(geoNormal * dirSign * liftFactor);
+
+                    const ivec2 & geoTexCoord(m_geoPixels[geoI].texCoord);
+                    if (isInCore(geoTexCoord)) {
+                        vec3 torq(glm::cross(vec3(geoWindPos, c.sliceZ), lift));
+                        totalLift += lift;
+                        totalTorq += torq;
+                        if (c.subModelCount) {
+                            Result & subModelResult(m_chunkSubModelResults[chunkI][m_subModel[geoTexCoord.y * m_texSize.x + geoTexCoord.x] - 1]);
+                            subModelResult.lift += lift;
+                            subModelResult.torq += torq;
+                        }
+                    }
+                }
+
+                // Update velocity
+                airVelocity += backforce * c.dt;
+                // Sweep back by diminishing xy components, less so in wind shadow
+                float factor(k_doWindShadow ? glm::mix(c.flowback, 1.0f, getTexShadFactor(airTexPos)) : c.flowback);
+                factor = std::pow(factor, c.sliceSize);
+                airVelocity *= factor;
+
+                // Update location
+                airWindPos += airVelocity * c.dt;
+
+                // Air crossing the plane of symmetry meets its mirror image crossing the other way, so turns back as it would
+                if (c.isMirrored && airWindPos.x < 0.0f) {
+                    airWindPos.x = -airWindPos.x;
+                    airVelocity.x = -airVelocity.x;
+                    backforce.x = -backforce.x;
+                }
+
+                air.windPos = airWindPos;
+                air.velocity = airVelocity;
+                air.backforce = backforce;
+                air.turbulence.x = airTurbulence;
+            }
+
+            m_chunkForces[chunkI] = totalLift;
+            m_chunkTorqs[chunkI] = totalTorq;
+        });
+
+        Result & result(m_results[c.slice]);
+        for (int chunkI(0); chunkI < chunks; ++chunkI) {
+            for (int texelI : m_chunkTurbWrites[chunkI]) m_turb[texelI] = 255;
+            result.lift += m_chunkForces[chunkI];
+            result.torq += m_chunkTorqs[chunkI];
+            m_stats[c.slice].searchSteps += m_chunkStats[chunkI].searchSteps;
+            m_stats[c.slice].turbulenceHits += m_chunkStats[chunkI].turbulenceHits;
+        }
+        gatherChunkSubModelResults(chunks);
+    }
+
+    // Readies each chunk's share of each sub model's result to be added to, when attributing
+    void CPUBackend::clearChunkSubModelResults(int chunks) {
+        if (!m_constants.subModelCount) {
+            return;
+        }
+        if (int(m_chunkSubModelResults.size()) < chunks) {
+            m_chunkSubModelResults.resize(chunks);
+        }
+        for (int chunkI(0); chunkI < chunks; ++chunkI) {
+            m_chunkSubModelResults[chunkI].assign(m_constants.subModelCount, Result{});
+        }
+    }
+
+    // Adds each chunk's share of each sub model's result to the slice's, in chunk order so the sums don't depend on timing
+    void CPUBackend::gatherChunkSubModelResults(int chunks) {
+        int subModelCount(m_constants.subModelCount);
+        for (int chunkI(0); chunkI < chunks && subModelCount; ++chunkI) {
+            for (int subModelI(0); subModelI < subModelCount; ++subModelI) {
+                const Result & chunkResult(m_chunkSubModelResults[chunkI][subModelI]);
+                Result & result(m_subModelResults[m_constants.slice * subModelCount + subModelI]);
+                result.lift += chunkResult.lift;
+                result.drag += chunkResult.drag;
+                result.torq += chunkResult.torq;
+            }
+        }
+    }
+
+    // Pixels on the border also stand in for those just past it, which the turbulence filtering can reach too
+    bool CPUBackend::isOccupied(const ivec2 & texCoord) const {
+        if (m_front[texCoord.y * m_texSize.x + texCoord.x].flags & (k_geoBit | k_airBit)) {
+            return true;
+        }
+        if (!k_doTurbulence) {
+            return false;
+        }
+
+        // Texels `sampleQuarter` can touch anywhere on the pixel, plus one more each way to match the GPU's margin
+        vec2 scale(vec2(m_quarterSize) / vec2(m_texSize));
+        ivec2 turbMin(ivec2(glm::floor(vec2(texCoord) * scale - 0.5f)) - 1);
+        ivec2 turbMax(ivec2(glm::floor(vec2(texCoord + 1) * scale - 0.5f)) + 2);
+        turbMin = glm::max(turbMin, ivec2(0));
+        turbMax = glm::min(turbMax, m_quarterSize - 1);
+        if (texCoord.x == 0) turbMin.x = 0;
+        if (texCoord.y == 0) turbMin.y = 0;
+        if (texCoord.x == m_constants.texSize.x - 1) turbMax.x = m_quarterSize.x - 1;
+        if (texCoord.y == m_constants.texSize.y - 1) turbMax.y = m_quarterSize.y - 1;
+        for (int y(turbMin.y); y <= turbMax.y; ++y) {
+            for (int x(turbMin.x); x <= turbMax.x; ++x) {
+                if (m_prevTurb[y * m_quarterSize.x + x]) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // Jumps in whole pixels short of the clear radius, so wherever on the pixel the search is, it stays within it
+    float CPUBackend::getSkipDist(const ivec2 & texCoord) const {
+        if (!k_doSearchSkipping || !isInTexture(texCoord)) {
+            return 0.0f;
+        }
+        int dist(m_dist[texCoord.y * m_texSize.x + texCoord.x]);
+        int radius(0);
+        for (int passI(1); passI < dist; ++passI) radius = radius * 3 + 1;
+        return float(std::max(radius - 1, 0));
+    }
+
+    bool CPUBackend::isInTexture(const ivec2 & texCoord) const {
+        return texCoord.x >= 0 && texCoord.y >= 0 && texCoord.x < m_constants.texSize.x && texCoord.y < m_constants.texSize.y;
+    }
+
+    ivec2 CPUBackend::mirrorTexCoord(const ivec2 & texCoord) const {
+        return m_constants.isMirrored && texCoord.x < 0 ? ivec2(-1 - texCoord.x, texCoord.y) : texCoord;
+    }
+
+    // The texture's left edge is the plane of symmetry when mirrored, so a search that crosses it carries on as its mirror
+    // image would on this side
+    void CPUBackend::reflectSearch(vec2 & r_searchTexPos, ivec2 & r_searchPixel, vec2 & r_searchDir, vec2 & r_corner) const {
+        if (m_constants.isMirrored && r_searchPixel.x < 0) {
+            r_searchTexPos.x = -r_searchTexPos.x;
+            r_searchPixel.x = -1 - r_searchPixel.x;
+            r_searchDir.x = -r_searchDir.x;
+            r_corner.x = 1.0f - r_corner.x;
+        }
+    }
+
+    bool CPUBackend::isInCore(const ivec2 & texCoord) const {
+        return glm::all(glm::greaterThanEqual(texCoord, m_constants.coreMin)) && glm::all(glm::lessThan(texCoord, m_constants.coreMax));
+    }
+
+    vec2 CPUBackend::windToTex(const vec2 & windPos) const {
+        return ((windPos - m_constants.windframeCenter) / m_constants.windframeSize + 0.5f) * vec2(m_constants.texSize);
+    }
+
+    vec2 CPUBackend::texToWind(const vec2 & texPos) const {
+        return (texPos / vec2(m_constants.texSize) - 0.5f) * m_constants.windframeSize + m_constants.windframeCenter;
+    }
+
+    float CPUBackend::texToWindDist(float texDist) const {
+        return texDist / float(m_constants.texSize.x) * m_constants.windframeSize.x;
+    }
+
+    // Mirrors a `GL_LINEAR` lookup of one of the quarter resolution R8 textures with a zero border
+    float CPUBackend::sampleQuarter(const std::vector<u08> & tex, const vec2 & texPos) const {
+        vec2 p(texPos * (vec2(m_quarterSize) / vec2(m_texSize)) - 0.5f);
+        ivec2 p0(glm::floor(p));
+        vec2 f(p - vec2(p0));
+        float vals[2][2];
+        for (int y(0); y < 2; ++y) {
+            for (int x(0); x < 2; ++x) {
+                ivec2 q(p0.x + x, p0.y + y);
+                bool isIn(q.x >= 0 && q.y >= 0 && q.x < m_quarterSize.x && q.y < m_quarterSize.y);
+                vals[y][x] = isIn ? float(tex[q.y * m_quarterSize.x + q.x]) * (1.0f / 255.0f) : 0.0f;
+            }
+        }
+        return glm::mix(glm::mix(vals[0][0], vals[0][1], f.x), glm::mix(vals[1][0], vals[1][1], f.x), f.y);
+    }
+
+    bool CPUBackend::isTexInShadow(const vec2 & texPos) const {
+        return sampleQuarter(m_shad, texPos) > 0.0f;
+    }
+
+    bool CPUBackend::isTexTurbulent(const vec2 & texPos) const {
+        return sampleQuarter(m_prevTurb, texPos) > 0.0f;
+    }
+
+    int CPUBackend::turbTexelI(const vec2 & texPos) const {
+        ivec2 q(glm::clamp(ivec2(texPos * 0.25f), ivec2(0), m_quarterSize - 1));
+        return q.y * m_quarterSize.x + q.x;
+    }
+
+    float CPUBackend::getTexShadFactor(const vec2 & texPos) const {
+        float shad(sampleQuarter(m_shad, texPos));
+        float shadDepth(shad * m_constants.windframeDepth);
+        float currDepth(m_constants.windframeDepth * 0.5f - m_constants.sliceZ); // Of the front of the slice
+        return float(shad != 0.0f) * glm::max(1.0f - (currDepth - shadDepth) / m_constants.windShadDist, 0.0f);
+    }
+
+}
\ No newline at end of file
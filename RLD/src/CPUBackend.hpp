@@ -0,0 +1,163 @@
+#pragma once
+
+
+
+#include <vector>
+
+#include "Common/Global.hpp"
+#include "Common/Model.hpp"
+
+#include "RLD.hpp"
+#include "Internal.hpp"
+#include "ThreadPool.hpp"
+#include "SlabClipper.hpp"
+
+
+
+namespace rld {
+
+    // CPU implementation of the per-slice pipeline
+    // Each stage mirrors its GPU counterpart (`foil.vert/frag`, `prospect.comp`, `draw.comp`, `distance.comp`,
+    // `outline.comp`, and `move.comp`) and spreads its per-pixel loop across all cores. Needs no OpenGL context, so the model's meshes
+    // need not be uploaded. Cloth is not supported, as soft meshes only live on the GPU
+    class CPUBackend {
+
+        public:
+
+        // Mirrors the RGBA8UI front texture
+        struct FrontTexel {
+            u08 flags; // geo, air, and active bits
+            u08 subX, subY; // Sub-pixel wind position in 1/255ths of a pixel
+            u08 _0;
+        };
+
+        CPUBackend(const ivec2 & texSize, int maxGeoPixels, int maxAirPixels, int sliceCount, int threadCount = 0);
+
+        // Clears everything carried from one slice to the next. Must be called before the first slice of a sweep
+        void reset();
+
+        // Runs the full pipeline for the slice described by `constants`
+        // If `r_capture` is given, the slice's geometry pixels, drag, and torque are recorded in it
+        void step(const Constants & constants, const Model & model, const mat4 & modelMat, const mat3 & normalMat, GeometryCacheEntry * r_capture = nullptr);
+
+        // Same as `step`, but the geometry pass is replaced by what was recorded for the slice
+        void replay(const Constants & constants, const GeometryCacheEntry & cache);
+
+        // Saves or restores everything carried from one slice to the next, along with the results so far
+        void saveCheckpoint(SweepCheckpoint & r_checkpoint) const;
+        void restoreCheckpoint(const SweepCheckpoint & checkpoint);
+
+        // Runs only the geometry pass for the slab described by `constants`, filling the front, normal, and index images
+        void rasterize(const Constants & constants, const Model & model, const mat4 & modelMat, const mat3 & normalMat);
+
+        // Whether drag is found from the exact area of the slab's polygons rather than from its pixels
+        void setExactDrag(bool enable) { m_isExactDrag = enable; }
+        bool isExactDrag() const { return m_isExactDrag; }
+
+        const std::vector<Result> & results() const { return m_results; }
+
+        // Each slice's result for each sub model, as `Simulator::subModelResults`. Empty unless the constants have a sub model count
+        const std::vector<Result> & subModelResults() const { return m_subModelResults; }
+
+        // Each slice's statistics, as `Simulator::stats`
+        const std::vector<SliceStats> & stats() const { return m_stats; }
+
+        const std::vector<FrontTexel> & front() const { return m_front; }
+        const std::vector<vec3> & norm() const { return m_norm; }
+        const std::vector<u32> & index() const { return m_index; }
+
+        int threadCount() const { return m_pool.threadCount(); }
+
+        private:
+
+        struct ShadWrite {
+            int texelI;
+            u08 val;
+        };
+
+        void renderGeometry(const Model & model, const mat4 & modelMat, const mat3 & normalMat);
+        void rasterizeLine(const SlabVertex & v0, const SlabVertex & v1, const SlabPolygon & polygon, int rowBegin, int rowEnd);
+        void rasterizeTriangle(const SlabVertex & v0, const SlabVertex & v1, const SlabVertex & v2, const SlabPolygon & polygon, int rowBegin, int rowEnd);
+        void writeFragment(int x, int y, const vec2 & texPos, float z, const vec3 & norm, const SlabPolygon & polygon);
+
+        void clearFront(int rowBegin, int rowEnd);
+        void computeExactDrag();
+        void computeProspect(GeometryCacheEntry * r_capture);
+        void computeScatter(const CachedPixel * pixels, int pixelCount);
+        void computeAir();
+        void computeDraw();
+        void computeDistance();
+        void computeOutline();
+        void computeMove();
+        void clearChunkSubModelResults(int chunks);
+        void gatherChunkSubModelResults(int chunks);
+
+        int findAir(const vec2 & geoTexPos, const ivec2 & geoTexCoord, vec2 searchDir, std::vector<int> & r_turbAirs, std::vector<int> & r_turbWrites, int & r_searchSteps) const;
+
+        bool isOccupied(const ivec2 & texCoord) const; // Whether a search could stop anywhere on the pixel
+        float getSkipDist(const ivec2 & texCoord) const; // How far a search may jump from the pixel, in pixels
+        bool isInTexture(const ivec2 & texCoord) const;
+        ivec2 mirrorTexCoord(const ivec2 & texCoord) const; // Across the plane of symmetry, when mirrored, is this side's mirror image
+        void reflectSearch(vec2 & r_searchTexPos, ivec2 & r_searchPixel, vec2 & r_searchDir, vec2 & r_corner) const;
+        bool isInCore(const ivec2 & texCoord) const; // Whether forces on geometry at this pixel count towards the results
+        vec2 windToTex(const vec2 & windPos) const;
+        vec2 texToWind(const vec2 & texPos) const;
+        float texToWindDist(float texDist) const;
+        float sampleQuarter(const std::vector<u08> & tex, const vec2 & texPos) const;
+        bool isTexInShadow(const vec2 & texPos) const;
+        bool isTexTurbulent(const vec2 & texPos) const;
+        int turbTexelI(const vec2 & texPos) const;
+        float getTexShadFactor(const vec2 & texPos) const;
+
+        ThreadPool m_pool;
+        SlabClipper m_clipper;
+        ivec2 m_texSize; // Width and height of the images, of which only the constants' `texSize` may be in use
+        ivec2 m_quarterSize; // Width and height of the turbulence and shadow textures
+        int m_maxGeoPixels;
+        int m_maxAirPixels;
+        Constants m_constants; // Constants of the current slice
+        bool m_isExactDrag;
+
+        // Mirrors of the GPU textures
+        std::vector<FrontTexel> m_front;
+        std::vector<vec3> m_norm;
+        std::vector<u32> m_index; // Triangle index + 1, as the cloth index image, though nothing here reads it
+        std::vector<u32> m_subModel; // Sub model index + 1, as the index image without cloth
+        std::vector<float> m_depth; // Wind z of the nearest fragment
+        std::vector<s32> m_flag;
+        std::vector<u08> m_turb;
+        std::vector<u08> m_prevTurb;
+        std::vector<u08> m_shad;
+        std::vector<u08> m_dist;
+        std::vector<u08> m_prevDist; // What the last distance pass wrote
+
+        // Mirrors of the GPU buffers
+        std::vector<GeoPixel> m_geoPixels;
+        std::vector<AirPixel> m_airPixels;
+        std::vector<AirPixel> m_prevAirPixels;
+        int m_geoCount; // Geo pixels found this slice, including any past the max
+        int m_airCount; // Same for air pixels
+        std::vector<s32> m_airGeoMap;
+        std::vector<Result> m_results;
+        std::vector<Result> m_subModelResults;
+        std::vector<SliceStats> m_stats;
+
+        // Per chunk scratch, kept between slices to avoid reallocation
+        std::vector<SlabPolygon> m_polygons; // The slab's polygons, with xy in tex space
+        std::vector<std::vector<GeoPixel>> m_chunkGeoPixels;
+        std::vector<std::vector<CachedPixel>> m_chunkCachedPixels;
+        std::vector<std::vector<ShadWrite>> m_chunkShadWrites;
+        std::vector<std::vector<AirPixel>> m_chunkAirs;
+        std::vector<std::vector<ivec2>> m_chunkAirTexCoords;
+        std::vector<std::vector<ivec2>> m_chunkAirGeoMaps; // Pairs of air index and geo index + 1
+        std::vector<std::vector<int>> m_chunkSpawns; // Indices of geo pixels that should spawn air
+        std::vector<std::vector<int>> m_chunkTurbAirs; // Indices of air pixels that became turbulent
+        std::vector<std::vector<int>> m_chunkTurbWrites; // Turbulence texels to set
+        std::vector<vec3> m_chunkForces;
+        std::vector<vec3> m_chunkTorqs;
+        std::vector<std::vector<Result>> m_chunkSubModelResults; // Only when attributing
+        std::vector<SliceStats> m_chunkStats; // Only the search steps and turbulence hits
+
+    };
+
+}
\ No newline at end of file
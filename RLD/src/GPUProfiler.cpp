@@ -0,0 +1,202 @@
+#include "GPUProfiler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+
+#include "glad/glad.h"
+
+
+
+namespace rld {
+
+    static constexpr int k_profileSlotCount(256); // Slices that may be in flight before any go untimed
+    static constexpr size_t k_profileSliceWindow(4096); // Slice times kept per stage
+    static constexpr size_t k_profileSweepWindow(64); // Sweep times kept per stage
+
+    static const char * const k_stageNames[]{ "setup", "geometry", "prospect", "compact", "scatter", "turbulence copy", "draw", "distance", "outline", "move", "debug" };
+    static_assert(std::size(k_stageNames) == size_t(ProfileStage::count), "Every stage needs a name");
+
+    static void summarize(const std::vector<float> & samples, float & r_min, float & r_avg, float & r_p99) {
+        if (samples.empty()) {
+            r_min = r_avg = r_p99 = 0.0f;
+            return;
+        }
+
+        std::vector<float> sorted(samples);
+        std::sort(sorted.begin(), sorted.end());
+        double sum(0.0);
+        for (float sample : sorted) sum += sample;
+        r_min = sorted.front();
+        r_avg = float(sum / double(sorted.size()));
+        r_p99 = sorted[size_t(std::ceil(0.99 * double(sorted.size()))) - 1];
+    }
+
+
+
+    GPUProfiler::GPUProfiler(int reportPeriod) :
+        m_reportPeriod(reportPeriod),
+        m_slots(k_profileSlotCount),
+        m_nextSlot(0),
+        m_pendingCount(0),
+        m_isSlicing(false),
+        m_sweep(0),
+        m_isSweepPartial(false),
+        m_collectSweep(0),
+        m_sweepTimes{},
+        m_sweepsCollected(0),
+        m_sliceWindows{},
+        m_sweepWindows{}
+    {
+        for (Slot & slot : m_slots) {
+            glGenQueries(k_stageCount + 1, slot.queries);
+        }
+        std::fill_n(m_sweepTimes, k_stageCount, -1.0f);
+    }
+
+    GPUProfiler::~GPUProfiler() {
+        for (Slot & slot : m_slots) {
+            glDeleteQueries(k_stageCount + 1, slot.queries);
+        }
+    }
+
+    void GPUProfiler::beginSlice() {
+        collect();
+
+        // Rather than wait on the oldest slice, this one goes untimed, and so does its sweep
+        if (m_pendingCount >= int(m_slots.size())) {
+            m_isSlicing = false;
+            m_isSweepPartial = true;
+            return;
+        }
+
+        Slot & slot(m_slots[m_nextSlot]);
+        glQueryCounter(slot.queries[0], GL_TIMESTAMP);
+        slot.stageCount = 0;
+        m_isSlicing = true;
+    }
+
+    void GPUProfiler::mark(ProfileStage stage) {
+        if (!m_isSlicing) {
+            return;
+        }
+
+        Slot & slot(m_slots[m_nextSlot]);
+        if (slot.stageCount >= k_stageCount) {
+            return;
+        }
+        glQueryCounter(slot.queries[slot.stageCount + 1], GL_TIMESTAMP);
+        slot.stages[slot.stageCount] = stage;
+        ++slot.stageCount;
+    }
+
+    void GPUProfiler::endSlice(bool isSweepEnd) {
+        if (m_isSlicing) {
+            Slot & slot(m_slots[m_nextSlot]);
+            slot.sweep = m_sweep;
+            slot.isSweepEnd = isSweepEnd;
+            slot.isSweepPartial = m_isSweepPartial;
+            m_nextSlot = (m_nextSlot + 1) % int(m_slots.size());
+            ++m_pendingCount;
+            m_isSlicing = false;
+        }
+        if (isSweepEnd) {
+            ++m_sweep;
+            m_isSweepPartial = false;
+        }
+
+        collect();
+    }
+
+    std::vector<StageProfile> GPUProfiler::profile() const {
+        std::vector<StageProfile> profile(k_stageCount);
+        for (int stageI(0); stageI < k_stageCount; ++stageI) {
+            StageProfile & stage(profile[stageI]);
+            stage.name = k_stageNames[stageI];
+            stage.sliceCount = int(m_sliceWindows[stageI].samples.size());
+            summarize(m_sliceWindows[stageI].samples, stage.sliceMin, stage.sliceAvg, stage.sliceP99);
+            stage.sweepCount = int(m_sweepWindows[stageI].samples.size());
+            summarize(m_sweepWindows[stageI].samples, stage.sweepMin, stage.sweepAvg, stage.sweepP99);
+        }
+        return profile;
+    }
+
+    std::string GPUProfiler::report() const {
+        std::ostringstream report;
+        report << std::fixed << std::setprecision(1);
+        report << std::left << std::setw(16) << "stage (us)" << std::right;
+        report << std::setw(8) << "slices" << std::setw(10) << "min" << std::setw(10) << "avg" << std::setw(10) << "p99";
+        report << std::setw(8) << "sweeps" << std::setw(10) << "min" << std::setw(10) << "avg" << std::setw(10) << "p99" << "\n";
+        for (const StageProfile & stage : profile()) {
+            if (!stage.sliceCount) {
+                continue;
+            }
+            report << std::left << std::setw(16) << stage.name << std::right;
+            report << std::setw(8) << stage.sliceCount << std::setw(10) << stage.sliceMin << std::setw(10) << stage.sliceAvg << std::setw(10) << stage.sliceP99;
+            report << std::setw(8) << stage.sweepCount << std::setw(10) << stage.sweepMin << std::setw(10) << stage.sweepAvg << std::setw(10) << stage.sweepP99 << "\n";
+        }
+        return report.str();
+    }
+
+    // Reads the slices the GPU has finished, oldest first, stopping at the first it hasn't
+    void GPUProfiler::collect() {
+        while (m_pendingCount) {
+            Slot & slot(m_slots[(m_nextSlot - m_pendingCount + int(m_slots.size())) % int(m_slots.size())]);
+
+            // Timestamps are written in order, so the last being available means they all are
+            u32 isAvailable(0);
+            glGetQueryObjectuiv(slot.queries[slot.stageCount], GL_QUERY_RESULT_AVAILABLE, &isAvailable);
+            if (!isAvailable) {
+                break;
+            }
+            --m_pendingCount;
+
+            // The first slice of a new sweep. Whatever was summed of the last was missing its end
+            if (slot.sweep != m_collectSweep) {
+                std::fill_n(m_sweepTimes, k_stageCount, -1.0f);
+                m_collectSweep = slot.sweep;
+            }
+
+            u64 prevTime(0);
+            glGetQueryObjectui64v(slot.queries[0], GL_QUERY_RESULT, &prevTime);
+            for (int i(0); i < slot.stageCount; ++i) {
+                u64 time(0);
+                glGetQueryObjectui64v(slot.queries[i + 1], GL_QUERY_RESULT, &time);
+                float microseconds(float(time - prevTime) * 1.0e-3f);
+                prevTime = time;
+
+                int stageI(int(slot.stages[i]));
+                addSample(m_sliceWindows[stageI], microseconds, k_profileSliceWindow);
+                m_sweepTimes[stageI] = glm::max(m_sweepTimes[stageI], 0.0f) + microseconds;
+            }
+
+            if (!slot.isSweepEnd) {
+                continue;
+            }
+            if (!slot.isSweepPartial) {
+                for (int stageI(0); stageI < k_stageCount; ++stageI) {
+                    if (m_sweepTimes[stageI] >= 0.0f) addSample(m_sweepWindows[stageI], m_sweepTimes[stageI], k_profileSweepWindow);
+                }
+                ++m_sweepsCollected;
+                if (m_reportPeriod > 0 && m_sweepsCollected % m_reportPeriod == 0) {
+                    std::cout << report() << std::endl;
+                }
+            }
+            std::fill_n(m_sweepTimes, k_stageCount, -1.0f);
+            m_collectSweep = slot.sweep + 1;
+        }
+    }
+
+    void GPUProfiler::addSample(Window & window, float sample, size_t capacity) {
+        if (window.samples.size() < capacity) {
+            window.samples.push_back(sample);
+            return;
+        }
+        window.samples[window.next] = sample;
+        window.next = (window.next + 1) % capacity;
+    }
+
+}
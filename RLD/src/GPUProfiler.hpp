@@ -0,0 +1,84 @@
+#pragma once
+
+
+
+#include <string>
+#include <vector>
+
+#include "Common/Global.hpp"
+
+#include "RLD.hpp"
+
+
+
+namespace rld {
+
+    // Times each stage of the GPU pipeline of every slice
+    // Each slice writes a timestamp as it begins and another as each of its stages ends, so a stage's time is the
+    // difference from the one before. The queries are polled in the order they were issued and only read once they're
+    // available, some slices later, so the CPU never waits on the GPU. Timestamps are used rather than `GL_TIME_ELAPSED`
+    // queries as those can't nest, and `stepFor` already times whole slices with one
+    class GPUProfiler {
+
+        public:
+
+        // If `reportPeriod` is positive, `report` is written to standard output every that many sweeps
+        GPUProfiler(int reportPeriod);
+        GPUProfiler(const GPUProfiler &) = delete;
+        ~GPUProfiler();
+
+        GPUProfiler & operator=(const GPUProfiler &) = delete;
+
+        // Writes the timestamp the slice's first stage is timed from
+        void beginSlice();
+
+        // Writes the timestamp ending the stage, which ran since the last timestamp
+        void mark(ProfileStage stage);
+
+        // Finishes the slice, and collects any earlier slices the GPU is done with
+        void endSlice(bool isSweepEnd);
+
+        // The times of each stage over the recent slices and sweeps collected so far
+        std::vector<StageProfile> profile() const;
+
+        // `profile` as a table
+        std::string report() const;
+
+        private:
+
+        static constexpr int k_stageCount = int(ProfileStage::count);
+
+        struct Slot {
+            u32 queries[k_stageCount + 1]; // A timestamp as the slice began, then one as each of its stages ended
+            ProfileStage stages[k_stageCount]; // The stage each later timestamp ended
+            int stageCount;
+            u64 sweep; // Which sweep the slice was of
+            bool isSweepEnd; // Whether the slice was the sweep's last
+            bool isSweepPartial; // Whether a slice of the sweep so far went untimed, as every slot was still pending
+        };
+
+        // The most recent of some number of samples
+        struct Window {
+            std::vector<float> samples;
+            size_t next; // Where the next sample goes once full
+        };
+
+        void collect();
+        static void addSample(Window & window, float sample, size_t capacity);
+
+        int m_reportPeriod;
+        std::vector<Slot> m_slots; // Used in turn
+        int m_nextSlot;
+        int m_pendingCount; // Slots issued but not yet collected, which are those just before `m_nextSlot`
+        bool m_isSlicing; // Whether the slice in progress is being timed into `m_nextSlot`
+        u64 m_sweep; // Of the slice in progress
+        bool m_isSweepPartial; // Whether a slice of the sweep in progress went untimed
+        u64 m_collectSweep; // Of the slices being summed into `m_sweepTimes`
+        float m_sweepTimes[k_stageCount]; // Each stage's time so far in the sweep being collected, or negative if it hasn't run
+        int m_sweepsCollected;
+        Window m_sliceWindows[k_stageCount];
+        Window m_sweepWindows[k_stageCount];
+
+    };
+
+}
@@ -0,0 +1,200 @@
+#pragma once
+
+
+
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <type_traits>
+
+#include "Common/Global.hpp"
+#include "Common/Model.hpp"
+
+#include "RLD.hpp"
+
+
+
+// Definitions shared between the GPU and CPU implementations of the pipeline
+namespace rld {
+
+    static constexpr int k_maxPixelsDivisor(16); // Max geo or air pixels is total pixels in texture divided by this
+    static constexpr bool k_doTurbulence(false);
+    static constexpr bool k_doWindShadow(true);
+    static constexpr bool k_packPixels(false); // Whether the GPU stores pixels in half the space, at lower precision, so twice as many fit
+    static constexpr int k_maxPackedTexSize(16384); // Packed pixels have 14 bits for each texture coordinate
+
+    static constexpr u32 k_geoBit(1), k_airBit(2), k_activeBit(4); // Must also change in shaders
+    static constexpr float k_airDensity(1.0f);
+    static constexpr float k_minNormalZ(1.0f / 1000000.0f);
+    static constexpr float k_maxNormalZ(1.0f - k_minNormalZ);
+    static constexpr int k_maxEdgeSeekSteps(64); // Necessary in pathological cases where normals form a loop
+    static constexpr int k_geoCacheDivisor(32); // Max cached pixels of a sweep is total pixels across all slices divided by this
+    static constexpr int k_maxGeoCacheEntries(2); // Number of orientations whose geometry is kept
+    static constexpr int k_maxDistPasses(8); // Enough for the distance field to reach past a thousand pixels
+
+
+
+    // Shared with the shaders
+    #include "../../resources/RLD/shaders/pixels.glsl"
+
+    static_assert(sizeof(GeoPixel) == 32 && sizeof(AirPixel) == 32, "Must match std430");
+    static_assert(sizeof(PackedGeoPixel) == 16 && sizeof(PackedAirPixel) == 16, "Must match std430");
+
+    // The layouts of the GPU's pixels
+    using StoredGeoPixel = std::conditional_t<k_packPixels, PackedGeoPixel, GeoPixel>;
+    using StoredAirPixel = std::conditional_t<k_packPixels, PackedAirPixel, AirPixel>;
+
+    // Mirrors GPU struct
+    struct Constants {
+        s32 maxGeoPixels;
+        s32 maxAirPixels;
+        ivec2 texSize;
+        vec2 windframeSize; // width and height of the windframe, or of the current tile
+        vec2 windframeCenter; // wind space position of the center of the windframe, or of the current tile
+        ivec2 coreMin; // Only forces on geometry with texture coordinates in [coreMin, coreMax) are counted
+        ivec2 coreMax;
+        float liftC;
+        float dragC;
+        float windframeDepth; // depth of the windframe
+        float sliceSize; // Distance between slices in wind space
+        float turbulenceDist; // Distance at which turbulence will start (in wind space)
+        float maxSearchDist; // Max distance for the shader searches (in wind space)
+        float windShadDist; // How far back the wind shadow will stretch (in wind space)
+        float backforceC;
+        float flowback; // Fraction of air's lateral velocity to remain after 1 unit of distance
+        float initVelC;
+        float windSpeed;
+        float dt; // The time it would take to travel `s_sliceSize` at `s_windSpeed`
+        s32 slice; // Current slice
+        float sliceZ; // Current slice's wind z
+        float pixelSize; // Pixel width or height in wind space, as pixels are square
+        s32 isMirrored; // Whether the left edge of the texture is the windframe's plane of symmetry
+        s32 subModelCount; // Number of sub models forces are attributed to, or 0 if not attributing
+        s32 flagEpoch; // Stamped on the flags and tiles written this slice, so any left by earlier slices read as empty
+    };
+
+    // Number of distance field passes needed to cover a search of the given length in pixels
+    // Each pass takes the radius each pixel is known to be clear to from r to 3r + 1, starting from 0
+    inline int distPassCount(float searchDist) {
+        int passes(1), radius(0);
+        while (float(radius) < searchDist && passes < k_maxDistPasses) {
+            radius = radius * 3 + 1;
+            ++passes;
+        }
+        return passes;
+    }
+
+    // Size of the per layer counts at the start of the geo and air pixel buffers
+    // The pixels that follow are 16 byte aligned, as they are in std430
+    inline constexpr s64 pixelCountsSize(int layerCount) {
+        return s64((layerCount + 3) / 4) * 16;
+    }
+
+    // Mirrors GPU struct
+    // One pixel of geometry as found by the geometry pass
+    struct CachedPixel {
+        u32 texCoord; // x | y << 16
+        u32 color; // Sub-pixel x | sub-pixel y << 8 | edge << 16
+        u32 normalXY; // `packSnorm2x16` of the normal's x and y
+        u32 normalZ; // `packSnorm2x16` of the normal's z and 0
+    };
+
+    // Everything the geometry pass of a sweep depends on
+    struct GeometryKey {
+        const Model * model;
+        mat4 modelMat;
+        mat3 normalMat;
+        std::vector<mat4> subModelMats;
+        float windframeWidth;
+        float windframeDepth;
+        float windSpeed;
+        ivec2 sliceRange; // First slice and one past the last
+        std::vector<float> sliceDepths; // Where each slice starts when spaced adaptively, or empty
+        bool isMirrored; // Whether only the half of the windframe at x >= 0 is swept
+
+        bool operator==(const GeometryKey & other) const {
+            return
+                model == other.model &&
+                modelMat == other.modelMat &&
+                normalMat == other.normalMat &&
+                subModelMats == other.subModelMats &&
+                windframeWidth == other.windframeWidth &&
+                windframeDepth == other.windframeDepth &&
+                windSpeed == other.windSpeed &&
+                sliceRange == other.sliceRange &&
+                sliceDepths == other.sliceDepths &&
+                isMirrored == other.isMirrored;
+        }
+    };
+
+    // The output of the geometry pass for every slice of one orientation
+    struct GeometryCacheEntry {
+        GeometryKey key;
+        bool isValid; // Whether a full sweep has been captured
+        std::vector<s32> sliceStarts; // Index of each slice's first pixel, followed by the total pixel count
+        std::vector<Result> results; // Drag and torque of each slice
+        u32 pixelsBuffer; // Prefixed by the pixel count and capacity. Only used by the GPU backend
+        std::vector<CachedPixel> pixels; // Only used by the CPU backend
+    };
+
+    // Everything the state of a sweep partway through depends on
+    struct CheckpointKey {
+        GeometryKey geometry;
+        float variables[6]; // As given to `setVariables`
+        bool isExactDrag;
+        s32 subModelCount; // Sub models the results are attributed to, or 0
+
+        // Whether everything is the same but the sub models' matrices, which only invalidate the slices they touch
+        bool isCompatible(const CheckpointKey & other) const {
+            return
+                geometry.model == other.geometry.model &&
+                geometry.modelMat == other.geometry.modelMat &&
+                geometry.normalMat == other.geometry.normalMat &&
+                geometry.subModelMats.size() == other.geometry.subModelMats.size() &&
+                geometry.windframeWidth == other.geometry.windframeWidth &&
+                geometry.windframeDepth == other.geometry.windframeDepth &&
+                geometry.windSpeed == other.geometry.windSpeed &&
+                geometry.sliceRange == other.geometry.sliceRange &&
+                geometry.sliceDepths == other.geometry.sliceDepths &&
+                geometry.isMirrored == other.geometry.isMirrored &&
+                std::equal(std::begin(variables), std::end(variables), std::begin(other.variables)) &&
+                isExactDrag == other.isExactDrag &&
+                subModelCount == other.subModelCount;
+        }
+    };
+
+    // What a sweep carries from one slice to the next, as it was before one slice, along with the results so far
+    struct SweepCheckpoint {
+        int slice; // The slice about to be done
+        u32 buffer; // The previous slice's air pixels, then the results, then the sub model results, then the statistics. Only used by the GPU backend
+        s64 bufferSize; // Only used by the GPU backend
+        u32 turbTex; // Only used by the GPU backend
+        u32 shadTex; // Only used by the GPU backend
+        std::vector<AirPixel> airPixels; // Only used by the CPU backend
+        std::vector<u08> turb; // Only used by the CPU backend
+        std::vector<u08> shad; // Only used by the CPU backend
+        std::vector<Result> results; // Only used by the CPU backend
+        std::vector<Result> subModelResults; // Only used by the CPU backend
+        std::vector<SliceStats> stats; // Only used by the CPU backend
+    };
+
+    // One slot of the ring that asynchronous sweeps leave their results in
+    struct ResultsReadback {
+        u64 ticket; // Of the sweep whose results are held, or 0
+        u32 buffer; // Persistently mapped, holding the results then the statistics. Only used by the GPU backend
+        void * fence; // The `GLsync` signaled once the results have arrived, or null once seen to be. Only used by the GPU backend
+        const Result * results; // The mapping of `buffer`, or `cpuResults`
+        std::vector<Result> cpuResults; // Only used by the CPU backend
+        const SliceStats * stats; // The mapping of `buffer` past the results, or `cpuStats`
+        std::vector<SliceStats> cpuStats; // Only used by the CPU backend
+        bool isMirrored; // Whether the results are of one half of the windframe, still to be mirrored. Only used by the GPU backend
+        int level; // The level of detail of the results, which the GPU backend has still to spread if below full resolution
+    };
+
+    // Times the slices one call of `stepFor` did on the GPU
+    struct SliceTimer {
+        u32 query; // A `GL_TIME_ELAPSED` query
+        int sliceCount; // Slices timed, or 0 once the time has been collected
+    };
+
+}
\ No newline at end of file
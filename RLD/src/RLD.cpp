@@ -1,7 +1,11 @@
-#include "RLD.hpp"
+﻿#include "RLD.hpp"
 
 #include <memory>
 #include <iostream>
+#include <iterator>
+#include <algorithm>
+#include <limits>
+#include <cmath>
 
 #include "glad/glad.h"
 #include "glm/gtc/matrix_transform.hpp"
@@ -10,6 +14,12 @@
 #include "Common/GLSL.h"
 #include "Common/Util.hpp"
 
+#include "Internal.hpp"
+#include "CPUBackend.hpp"
+#include "GPUProfiler.hpp"
+#include "SlabClipper.hpp"
+#include "SlabIndex.hpp"
+
 
 
 
@@ -19,248 +29,424 @@ namespace rld {
     static constexpr int k_coresToUse(1024); // Otherwise, use this many
     static constexpr int k_warpSize(64); // Should correspond to target architecture
     static const ivec2 k_warpSize2D(8, 8); // The components multiplied must equal warp size
-    static constexpr int k_maxPixelsDivisor(16); // Max geo or air pixels is total pixels in texture divided by this
     static constexpr bool k_distinguishActivePixels(true); // In debug mode, makes certain "active" pixels brigher for visual clarity, but lowers performance
-    static constexpr bool k_doTurbulence(false);
-    static constexpr bool k_doWindShadow(true);
-
-
-
-    // Mirrors GPU struct
-    struct GeoPixel {
-        vec2 windPos;
-        ivec2 texCoord;
-        vec3 normal;
-        int edge;
-    };
-
-    // Mirrors GPU struct
-    struct AirPixel {
-        vec2 windPos;
-        vec2 velocity;
-        vec2 backforce;
-        vec2 turbulence;
-    };
-
-    // Mirrors GPU struct
-    struct Constants {
-        s32 maxGeoPixels;
-        s32 maxAirPixels;
-        s32 texSize;
-        float liftC;
-        float dragC;
-        float windframeSize; // width and height of the windframe
-        float windframeDepth; // depth of the windframe
-        float sliceSize; // Distance between slices in wind space
-        float turbulenceDist; // Distance at which turbulence will start (in wind space)
-        float maxSearchDist; // Max distance for the shader searches (in wind space)
-        float windShadDist; // How far back the wind shadow will stretch (in wind space)
-        float backforceC;
-        float flowback; // Fraction of air's lateral velocity to remain after 1 unit of distance
-        float initVelC;
-        float windSpeed;
-        float dt; // The time it would take to travel `s_sliceSize` at `s_windSpeed`
-        s32 slice; // Current slice
-        float sliceZ; // Current slice's wind z
-        float pixelSize; // Pixel width or height in wind space
-    };
-
-    // Mirrors GPU struct
-    struct GeoPixelsPrefix {
-        s32 geoCount;
-        s32 _0;
-        s32 _1;
-        s32 _2;
-    };
-
-    // Mirrors GPU struct
-    struct AirPixelsPrefix {
-        s32 airCount;
-        s32 _0;
-        s32 _1;
-        s32 _2;
-    };
-
-
-
-    static int s_workGroupSize; // At least 1024
-    static ivec2 s_workGroupSize2D; // At least 32x32
-    static int s_texSize; // Width and height of the textures, which are square
-    static int s_maxGeoPixels;
-    static int s_maxAirPixels;
-    static int s_sliceCount;
-    static float s_liftC;
-    static float s_dragC;
-
-    static const Model * s_model;
-    static mat4 s_modelMat;
-    static mat3 s_normalMat;
-    static float s_windframeWidth;
-    static float s_windframeDepth;
-    static float s_sliceSize;
-    static float s_turbulenceDist;
-    static float s_maxSearchDist;
-    static float s_windShadDist;
-    static float s_backforceC;
-    static float s_flowback;
-    static float s_initVelC;
-    static float s_windSpeed;
-    static float s_dt; // The time it would take to travel `s_sliceSize` at `s_windSpeed`
-    static bool s_debug; // Whether to enable non essentials like side view or active pixel highlighting
-    static bool s_doSide; // Whether to render side texture
-    static bool s_doCloth; // Whether this is a cloth simulation
-
-    static int s_currentSlice(0); // slice index [0, sliceCount)
-    static std::vector<Result> s_results; // Results for each slice
-    static Result s_result; // Cumulative result of all slices
-    static int s_swap; // Only used for the air pixel buffer
-
-    static unq<Shader> s_foilShader, s_foilShaderDebug;
-    static unq<Shader> s_prospectShader, s_prospectShaderDebug;
-    static unq<Shader> s_drawShader, s_drawShaderDebug;
-    static unq<Shader> s_outlineShader, s_outlineShaderDebug;
-    static unq<Shader> s_moveShader, s_moveShaderDebug;
-    static unq<Shader> s_prettyShader, s_sideShader;
-
-    static Constants s_constants; // CPU copy of constants
-
-    static u32 s_constantsBuffer;
-    static u32 s_resultsBuffer;
-    static u32 s_geoPixelsBuffer;
-    static u32 s_airPixelsBuffer[2];
-    static u32 s_airGeoMapBuffer;
-
-    static u32 s_fbo; // The handle for the framebuffer object
-    static u32 s_frontTex_unorm; // A view of s_fboTex that is RGBA8
-    static u32 s_frontTex_uint; // The handle for the front texture (RGBA8UI)
-    static u32 s_normTex; // The handle for the normal texture (RGBA16_SNORM)
-    static u32 s_flagTex; // The handle for the flag texture (R32UI)
-    static u32 s_turbTex; // The handle for the turbulence texture (R8)
-    static u32 s_prevTurbTex; // The handle for the previous turbulence texture (R8)
-    static u32 s_shadTex; // The handle for the wind shadow texture (R8)
-    static u32 s_indexTex; // The handle for the index texture (R32UI);
-    static u32 s_sideTex; // The handle for the side texture (RGBA8)
-
-
-
-    static bool setupShaders() {
+    static constexpr int k_readbackCount(3); // How many asynchronous sweeps' results may be waiting to be picked up
+    static constexpr float k_symmetryTolerance(1.0e-4f); // How far matrix elements may be from those of a mirror image, relative to the largest
+    static constexpr int k_sliceTimerCount(4); // How many of `stepFor`'s calls may be timed at once on the GPU
+    static constexpr float k_sliceCostWeight(0.25f); // How much each new measure moves the running average of a slice's cost
+    static constexpr int k_scheduleBinsPerSlice(8); // How finely the depth is sampled when spacing slices adaptively
+    static constexpr float k_evenSpacingShare(0.25f); // How much of the adaptive spacing is even regardless of the model
+    static constexpr int k_drawDispatchStage(0), k_outlineDispatchStage(1), k_moveDispatchStage(2); // Must also change in `dispatch.comp`
+    static constexpr int k_prospectDispatchStage(3); // Counted by `foil.frag` rather than `dispatch.comp`
+    static constexpr int k_dispatchStageCount(4);
+    static constexpr int k_frontEpochCount(31); // Must also change in `front.glsl`
+    static constexpr u32 k_normFormat(k_packPixels ? GL_RG16_SNORM : GL_RGBA16_SNORM); // Packed pixels' normals are octahedral, so need only two components
+
+    // Whether `b` is `a` mirrored across x = 0, to within tolerance
+    static bool isMirrorImage(const mat4 & a, const mat4 & b) {
+        const mat4 mirror(glm::scale(mat4(), vec3(-1.0f, 1.0f, 1.0f)));
+        mat4 mirroredA(mirror * a * mirror);
+        float maxElement(1.0f), maxDiff(0.0f);
+        for (int col(0); col < 4; ++col) {
+            for (int row(0); row < 4; ++row) {
+                maxElement = glm::max(maxElement, glm::abs(a[col][row]));
+                maxDiff = glm::max(maxDiff, glm::abs(mirroredA[col][row] - b[col][row]));
+            }
+        }
+        return maxDiff <= maxElement * k_symmetryTolerance;
+    }
+
+    // Turns results found over the half of the windframe at x >= 0 into those of the whole by adding their mirror images
+    // Forces keep their y and z, and torques, being cross products, keep their x
+    static void mirrorResults(Result * results, int count) {
+        for (int i(0); i < count; ++i) {
+            Result & result(results[i]);
+            result.lift = vec3(0.0f, result.lift.y, result.lift.z) * 2.0f;
+            result.drag = vec3(0.0f, result.drag.y, result.drag.z) * 2.0f;
+            result.torq = vec3(result.torq.x, 0.0f, 0.0f) * 2.0f;
+        }
+    }
+
+
+
+    Simulator::Simulator() :
+        m_workGroupSize(0),
+        m_workGroupSize2D(),
+        m_texSize(),
+        m_maxGeoPixels(0),
+        m_maxAirPixels(0),
+        m_sliceCount(0),
+        m_batchCapacity(0),
+        m_liftC(0.0f),
+        m_dragC(0.0f),
+        m_model(nullptr),
+        m_modelMat(),
+        m_normalMat(),
+        m_windframeSize(),
+        m_windframeDepth(0.0f),
+        m_isFitting(false),
+        m_isSymmetric(false),
+        m_isMirrored(false),
+        m_fitMargin(0.0f),
+        m_fitBackMargin(0.0f),
+        m_firstSlice(0),
+        m_endSlice(0),
+        m_tileCount(1),
+        m_tileHalo(0),
+        m_tiles(1, 0),
+        m_sliceSize(0.0f),
+        m_turbulenceDist(0.0f),
+        m_maxSearchDist(0.0f),
+        m_windShadDist(0.0f),
+        m_backforceC(0.0f),
+        m_flowback(0.0f),
+        m_initVelC(0.0f),
+        m_windSpeed(0.0f),
+        m_dt(0.0f),
+        m_debug(false),
+        m_doSide(false),
+        m_doCloth(false),
+        m_backend(Backend::gpu),
+        m_cpuBackend(),
+        m_isExactDrag(false),
+        m_isAttributing(false),
+        m_isAdaptiveSlicing(false),
+        m_sliceDepths(),
+        m_isCheckpointing(false),
+        m_checkpointInterval(0),
+        m_checkpoints(),
+        m_checkpointKey(new CheckpointKey()),
+        m_areCheckpointsValid(false),
+        m_isCheckpointSweep(false),
+        m_resumeCheckpoint(nullptr),
+        m_levelCount(1),
+        m_level(0),
+        m_resultLevel(0),
+        m_slabIndices(),
+        m_currentSlice(0),
+        m_currentTile(0),
+        m_results(),
+        m_result(),
+        m_subModelResults(),
+        m_sweepResults(),
+        m_sweepSubModelResults(),
+        m_stats(),
+        m_sweepStats(),
+        m_swap(0),
+        m_batchSize(1),
+        m_batchModelMats(),
+        m_batchNormalMats(),
+        m_batchResults(),
+        m_isAsyncSweep(false),
+        m_readbacks(),
+        m_lastTicket(0),
+        m_stepForTicket(0),
+        m_sliceTimers(),
+        m_sliceCost(0.0f),
+        m_profiler(),
+        m_flagEpoch(0),
+        m_flagEpochCount(0),
+        m_isFrontPretty(false),
+        m_constants(new Constants()),
+        m_constantsBuffer(0),
+        m_resultsBuffer(0),
+        m_geoPixelsBuffer(0),
+        m_airPixelsBuffer{},
+        m_airGeoMapBuffer(0),
+        m_sliceStartsBuffer(0),
+        m_geoResultsBuffer(0),
+        m_rowCountsBuffer(0),
+        m_blockResultsBuffer(0),
+        m_subModelResultsBuffer(0),
+        m_subModelResultsSize(0),
+        m_statsBuffer(0),
+        m_blockCountsBuffer(0),
+        m_dispatchBuffer(0),
+        m_tileEpochsBuffer(0),
+        m_tilesBuffer(0),
+        m_isGeoCaching(false),
+        m_geoCache(),
+        m_geoCacheEntry(nullptr),
+        m_isGeoReplay(false),
+        m_geoCacheCapacity(0),
+        m_fbos(),
+        m_depthRenderbuffer(0),
+        m_frontTex_unorm(0),
+        m_frontTex_uint(0),
+        m_frontLayerTex(0),
+        m_normTex(0),
+        m_flagTex(0),
+        m_turbTex(0),
+        m_turbLayerTex(0),
+        m_prevTurbTex(0),
+        m_shadTex(0),
+        m_indexTex(0),
+        m_sideTex(0),
+        m_distTex{}
+    {}
+
+    Simulator::~Simulator() {
+        // Nothing was created on the GPU
+        if (m_backend == Backend::cpu || !m_constantsBuffer) {
+            return;
+        }
+
+        u32 buffers[]{ m_constantsBuffer, m_resultsBuffer, m_geoPixelsBuffer, m_airPixelsBuffer[0], m_airPixelsBuffer[1], m_airGeoMapBuffer, m_sliceStartsBuffer, m_geoResultsBuffer, m_rowCountsBuffer, m_blockResultsBuffer, m_subModelResultsBuffer, m_statsBuffer, m_blockCountsBuffer, m_dispatchBuffer, m_tileEpochsBuffer, m_tilesBuffer };
+        glDeleteBuffers(int(std::size(buffers)), buffers);
+        for (const unq<GeometryCacheEntry> & entry : m_geoCache) {
+            glDeleteBuffers(1, &entry->pixelsBuffer);
+        }
+        freeCheckpoints();
+        for (const ResultsReadback & readback : m_readbacks) {
+            glDeleteSync(static_cast<GLsync>(readback.fence)); // Zero is silently ignored
+            glDeleteBuffers(1, &readback.buffer); // Also unmaps it
+        }
+        for (const SliceTimer & timer : m_sliceTimers) {
+            glDeleteQueries(1, &timer.query);
+        }
+        glDeleteFramebuffers(int(m_fbos.size()), m_fbos.data());
+        glDeleteRenderbuffers(1, &m_depthRenderbuffer);
+        // Zero names are silently ignored
+        u32 textures[]{ m_frontLayerTex, m_frontTex_uint, m_frontTex_unorm, m_normTex, m_flagTex, m_turbLayerTex, m_turbTex, m_prevTurbTex, m_shadTex, m_indexTex, m_sideTex, m_distTex[0], m_distTex[1] };
+        glDeleteTextures(int(std::size(textures)), textures);
+    }
+
+    bool Simulator::setupShaders() {
         std::string shadersPath(g_resourcesDir + "/RLD/shaders/");
         // External shader defines
-        std::string workGroupSizeStr(std::to_string(s_workGroupSize));
-        std::string workGroupSize2DStr("ivec2(" + std::to_string(s_workGroupSize2D.x) + ", " + std::to_string(s_workGroupSize2D.y) + ")");
+        std::string workGroupSizeStr(std::to_string(m_workGroupSize));
+        std::string workGroupSize2DStr("ivec2(" + std::to_string(m_workGroupSize2D.x) + ", " + std::to_string(m_workGroupSize2D.y) + ")");
+        std::string batchCapacityStr(std::to_string(m_batchCapacity));
+        std::string sliceCountStr(std::to_string(m_sliceCount));
         std::vector<duo<std::string_view>> defines{
             { "WORK_GROUP_SIZE", workGroupSizeStr },
             { "WORK_GROUP_SIZE_2D", workGroupSize2DStr },
+            { "BATCH_CAPACITY", batchCapacityStr },
+            { "SLICE_COUNT", sliceCountStr },
             { "DISTINGUISH_ACTIVE_PIXELS", k_distinguishActivePixels ? "true" : "false" },
             { "DO_TURBULENCE", k_doTurbulence ? "true" : "false" },
             { "DO_WIND_SHADOW", k_doWindShadow ? "true" : "false" },
-            { "DO_CLOTH", s_doCloth ? "true" : "false" }
+            { "DO_CLOTH", m_doCloth ? "true" : "false" },
+            { "PACK_PIXELS", k_packPixels ? "1" : "0" } // Tested by `#if`, which can't take `true` or `false`
         };
         std::vector<duo<std::string_view>> debugDefines(defines);
         defines.push_back({ "DEBUG", "false" });
         debugDefines.push_back({ "DEBUG", "true" });
+        std::vector<duo<std::string_view>> captureDefines(defines), captureDebugDefines(debugDefines);
+        defines.push_back({ "DO_CAPTURE", "false" });
+        debugDefines.push_back({ "DO_CAPTURE", "false" });
+        captureDefines.push_back({ "DO_CAPTURE", "true" });
+        captureDebugDefines.push_back({ "DO_CAPTURE", "true" });
 
         // Foil shader
-        if (!(s_foilShader = Shader::load(shadersPath + "foil.vert", shadersPath + "foil.frag", defines))) {
+        if (!(m_foilShader = Shader::load(shadersPath + "foil.vert", shadersPath + "foil.frag", defines))) {
             std::cerr << "Failed to load foil shader" << std::endl;
             return false;
         }
-        if (!(s_foilShaderDebug = Shader::load(shadersPath + "foil.vert", shadersPath + "foil.frag", debugDefines))) {
+        if (!(m_foilShaderDebug = Shader::load(shadersPath + "foil.vert", shadersPath + "foil.frag", debugDefines))) {
             std::cerr << "Failed to load debug foil shader" << std::endl;
             return false;
         }
 
         // Prospect shader
-        if (!(s_prospectShader = Shader::load(shadersPath + "prospect.comp", defines))) {
+        if (!(m_prospectShader = Shader::load(shadersPath + "prospect.comp", defines))) {
             std::cerr << "Failed to load prospect shader" << std::endl;
             return false;
         }
-        if (!(s_prospectShaderDebug = Shader::load(shadersPath + "prospect.comp", debugDefines))) {
+        if (!(m_prospectShaderDebug = Shader::load(shadersPath + "prospect.comp", debugDefines))) {
             std::cerr << "Failed to load debug prospect shader" << std::endl;
             return false;
         }
+        if (!(m_prospectShaderCapture = Shader::load(shadersPath + "prospect.comp", captureDefines))) {
+            std::cerr << "Failed to load capture prospect shader" << std::endl;
+            return false;
+        }
+        if (!(m_prospectShaderCaptureDebug = Shader::load(shadersPath + "prospect.comp", captureDebugDefines))) {
+            std::cerr << "Failed to load debug capture prospect shader" << std::endl;
+            return false;
+        }
+
+        // Scatter shader
+        if (!(m_scatterShader = Shader::load(shadersPath + "scatter.comp", defines))) {
+            std::cerr << "Failed to load scatter shader" << std::endl;
+            return false;
+        }
+        if (!(m_scatterShaderDebug = Shader::load(shadersPath + "scatter.comp", debugDefines))) {
+            std::cerr << "Failed to load debug scatter shader" << std::endl;
+            return false;
+        }
+
+        // Compact shader
+        if (!(m_compactShader = Shader::load(shadersPath + "compact.comp", defines))) {
+            std::cerr << "Failed to load compact shader" << std::endl;
+            return false;
+        }
+        if (!(m_compactShaderCapture = Shader::load(shadersPath + "compact.comp", captureDefines))) {
+            std::cerr << "Failed to load capture compact shader" << std::endl;
+            return false;
+        }
+
+        // Distance compute shader
+        if (!(m_distanceShader = Shader::load(shadersPath + "distance.comp", defines))) {
+            std::cerr << "Failed to load distance shader" << std::endl;
+            return false;
+        }
 
         // Draw Compute shader
-        if (!(s_drawShader = Shader::load(shadersPath + "draw.comp", defines))) {
+        if (!(m_drawShader = Shader::load(shadersPath + "draw.comp", defines))) {
             std::cerr << "Failed to load draw shader" << std::endl;
             return false;
         }
-        if (!(s_drawShaderDebug = Shader::load(shadersPath + "draw.comp", debugDefines))) {
+        if (!(m_drawShaderDebug = Shader::load(shadersPath + "draw.comp", debugDefines))) {
             std::cerr << "Failed to load debug draw shader" << std::endl;
             return false;
         }
 
         // Outline compute shader
-        if (!(s_outlineShader = Shader::load(shadersPath + "outline.comp", defines))) {
+        if (!(m_outlineShader = Shader::load(shadersPath + "outline.comp", defines))) {
             std::cerr << "Failed to load outline shader" << std::endl;
             return false;
         }
-        if (!(s_outlineShaderDebug = Shader::load(shadersPath + "outline.comp", debugDefines))) {
+        if (!(m_outlineShaderDebug = Shader::load(shadersPath + "outline.comp", debugDefines))) {
             std::cerr << "Failed to load debug outline shader" << std::endl;
             return false;
         }
 
         // Move compute shader
-        if (!(s_moveShader = Shader::load(shadersPath + "move.comp", defines))) {
+        if (!(m_moveShader = Shader::load(shadersPath + "move.comp", defines))) {
             std::cerr << "Failed to load move shader" << std::endl;
             return false;
         }
-        if (!(s_moveShaderDebug = Shader::load(shadersPath + "move.comp", debugDefines))) {
+        if (!(m_moveShaderDebug = Shader::load(shadersPath + "move.comp", debugDefines))) {
             std::cerr << "Failed to load debug move shader" << std::endl;
             return false;
         }
 
+        // Dispatch shader
+        if (!(m_dispatchShader = Shader::load(shadersPath + "dispatch.comp", defines))) {
+            std::cerr << "Failed to load dispatch shader" << std::endl;
+            return false;
+        }
+
         // Pretty shader
-        if (!(s_prettyShader = Shader::load(shadersPath + "pretty.comp", defines))) {
+        if (!(m_prettyShader = Shader::load(shadersPath + "pretty.comp", defines))) {
             std::cerr << "Failed to load pretty shader" << std::endl;
             return false;
         }
 
         // Side shader
-        if (!(s_sideShader = Shader::load(shadersPath + "side.comp"))) {
+        if (!(m_sideShader = Shader::load(shadersPath + "side.comp"))) {
             std::cerr << "Failed to load side shader" << std::endl;
             return false;
         }
-        s_sideShader->bind();
-        s_sideShader->uniform("u_texSize", s_texSize);
+        m_sideShader->bind();
+        m_sideShader->uniform("u_texSize", m_texSize);
         Shader::unbind();
 
         return true;
     }
 
-    static bool setupBuffers() {
+    bool Simulator::setupBuffers() {
         // Constants buffer
-        glGenBuffers(1, &s_constantsBuffer);
-        glBindBuffer(GL_UNIFORM_BUFFER, s_constantsBuffer);
+        glGenBuffers(1, &m_constantsBuffer);
+        glBindBuffer(GL_UNIFORM_BUFFER, m_constantsBuffer);
         glBufferStorage(GL_UNIFORM_BUFFER, sizeof(Constants), nullptr, GL_DYNAMIC_STORAGE_BIT);
         glBindBuffer(GL_UNIFORM_BUFFER, 0);
 
         // Results buffer
-        glGenBuffers(1, &s_resultsBuffer);
-        glBindBuffer(GL_SHADER_STORAGE_BUFFER, s_resultsBuffer);
-        glBufferStorage(GL_SHADER_STORAGE_BUFFER, s_sliceCount * sizeof(Result), nullptr, GL_MAP_READ_BIT);
+        glGenBuffers(1, &m_resultsBuffer);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_resultsBuffer);
+        glBufferStorage(GL_SHADER_STORAGE_BUFFER, m_batchCapacity * m_sliceCount * sizeof(Result), nullptr, GL_MAP_READ_BIT | GL_DYNAMIC_STORAGE_BIT);
         glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 
         // Geometry pixels buffer
-        glGenBuffers(1, &s_geoPixelsBuffer);
-        glBindBuffer(GL_SHADER_STORAGE_BUFFER, s_geoPixelsBuffer);
-        glBufferStorage(GL_SHADER_STORAGE_BUFFER, sizeof(GeoPixelsPrefix) + s_maxGeoPixels * sizeof(GeoPixel), nullptr, GL_DYNAMIC_STORAGE_BIT);
+        glGenBuffers(1, &m_geoPixelsBuffer);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_geoPixelsBuffer);
+        glBufferStorage(GL_SHADER_STORAGE_BUFFER, pixelCountsSize(m_batchCapacity) + s64(m_batchCapacity) * m_maxGeoPixels * sizeof(StoredGeoPixel), nullptr, GL_DYNAMIC_STORAGE_BIT);
         glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 
         // Air pixels buffer
-        glGenBuffers(2, s_airPixelsBuffer);
-        glBindBuffer(GL_SHADER_STORAGE_BUFFER, s_airPixelsBuffer[0]);
-        glBufferStorage(GL_SHADER_STORAGE_BUFFER, sizeof(AirPixelsPrefix) + s_maxAirPixels * sizeof(AirPixel), nullptr, GL_DYNAMIC_STORAGE_BIT);
-        glBindBuffer(GL_SHADER_STORAGE_BUFFER, s_airPixelsBuffer[1]);
-        glBufferStorage(GL_SHADER_STORAGE_BUFFER, sizeof(AirPixelsPrefix) + s_maxAirPixels * sizeof(AirPixel), nullptr, GL_DYNAMIC_STORAGE_BIT);
+        glGenBuffers(2, m_airPixelsBuffer);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_airPixelsBuffer[0]);
+        glBufferStorage(GL_SHADER_STORAGE_BUFFER, pixelCountsSize(m_batchCapacity) + s64(m_batchCapacity) * m_maxAirPixels * sizeof(StoredAirPixel), nullptr, GL_DYNAMIC_STORAGE_BIT);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_airPixelsBuffer[1]);
+        glBufferStorage(GL_SHADER_STORAGE_BUFFER, pixelCountsSize(m_batchCapacity) + s64(m_batchCapacity) * m_maxAirPixels * sizeof(StoredAirPixel), nullptr, GL_DYNAMIC_STORAGE_BIT);
         glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 
         // Air geo map buffer
-        glGenBuffers(1, &s_airGeoMapBuffer);
-        glBindBuffer(GL_SHADER_STORAGE_BUFFER, s_airGeoMapBuffer);
-        glBufferStorage(GL_SHADER_STORAGE_BUFFER, s_maxAirPixels * sizeof(int), nullptr, 0);
+        glGenBuffers(1, &m_airGeoMapBuffer);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_airGeoMapBuffer);
+        glBufferStorage(GL_SHADER_STORAGE_BUFFER, s64(m_batchCapacity) * m_maxAirPixels * sizeof(int), nullptr, 0);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        // Slice starts buffer
+        glGenBuffers(1, &m_sliceStartsBuffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, m_sliceStartsBuffer);
+        glBufferStorage(GL_COPY_WRITE_BUFFER, (m_sliceCount + 1) * sizeof(s32), nullptr, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        // Geometry results buffer
+        glGenBuffers(1, &m_geoResultsBuffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, m_geoResultsBuffer);
+        glBufferStorage(GL_COPY_WRITE_BUFFER, m_sliceCount * sizeof(Result), nullptr, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        // Row counts buffer
+        glGenBuffers(1, &m_rowCountsBuffer);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_rowCountsBuffer);
+        glBufferStorage(GL_SHADER_STORAGE_BUFFER, s64(m_batchCapacity) * m_texSize.y * sizeof(ivec2), nullptr, GL_DYNAMIC_STORAGE_BIT);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        // Block results buffer, one per 8x8 prospect work group, or per move work group if there could be more of those
+        ivec2 blockCounts((m_texSize + 7) / 8);
+        int pixelBlockCapacity((std::max(m_maxGeoPixels, m_maxAirPixels) + m_workGroupSize - 1) / m_workGroupSize);
+        glGenBuffers(1, &m_blockResultsBuffer);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_blockResultsBuffer);
+        glBufferStorage(GL_SHADER_STORAGE_BUFFER, s64(m_batchCapacity) * std::max(blockCounts.x * blockCounts.y, pixelBlockCapacity) * 2 * sizeof(vec4), nullptr, 0);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        // Stats buffer
+        glGenBuffers(1, &m_statsBuffer);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_statsBuffer);
+        glBufferStorage(GL_SHADER_STORAGE_BUFFER, m_sliceCount * sizeof(SliceStats), nullptr, GL_DYNAMIC_STORAGE_BIT);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        // Block counts buffer, a draw then an outline region of work groups for each layer
+        glGenBuffers(1, &m_blockCountsBuffer);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_blockCountsBuffer);
+        glBufferStorage(GL_SHADER_STORAGE_BUFFER, s64(m_batchCapacity) * 2 * pixelBlockCapacity * sizeof(s32), nullptr, 0);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        // Dispatch buffer, the indirect dispatch arguments of each stage, then each layer's move work group counter
+        // Prospect's are only ever counted up in x and y, so start as ones
+        u32 one(1);
+        glGenBuffers(1, &m_dispatchBuffer);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_dispatchBuffer);
+        glBufferStorage(GL_SHADER_STORAGE_BUFFER, k_dispatchStageCount * 3 * sizeof(u32) + m_batchCapacity * sizeof(s32), nullptr, 0);
+        glClearBufferSubData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, 0, k_dispatchStageCount * 3 * sizeof(u32), GL_RED_INTEGER, GL_UNSIGNED_INT, &one);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        // Tile epochs and tiles buffers, one per 8x8 prospect work group
+        glGenBuffers(1, &m_tileEpochsBuffer);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_tileEpochsBuffer);
+        glBufferStorage(GL_SHADER_STORAGE_BUFFER, s64(m_batchCapacity) * blockCounts.x * blockCounts.y * sizeof(s32), nullptr, 0);
+        glGenBuffers(1, &m_tilesBuffer);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_tilesBuffer);
+        glBufferStorage(GL_SHADER_STORAGE_BUFFER, sizeof(s32) + s64(m_batchCapacity) * blockCounts.x * blockCounts.y * sizeof(s32), nullptr, 0);
         glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 
+        // Readback buffers, mapped for as long as they live
+        s64 readbackSize(m_sliceCount * (sizeof(Result) + sizeof(SliceStats)));
+        for (ResultsReadback & readback : m_readbacks) {
+            glGenBuffers(1, &readback.buffer);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, readback.buffer);
+            glBufferStorage(GL_COPY_WRITE_BUFFER, readbackSize, nullptr, GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT);
+            const void * mapping(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, readbackSize, GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT));
+            readback.results = static_cast<const Result *>(mapping);
+            readback.stats = reinterpret_cast<const SliceStats *>(readback.results + m_sliceCount);
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
         if (glGetError() != GL_NO_ERROR) {
             std::cerr << "OpenGL error" << std::endl;
             return false;
@@ -269,95 +455,117 @@ namespace rld {
         return true;
     }
 
-    static bool setupTextures() {
+    bool Simulator::setupTextures() {
         float emptyVal[4]{};
 
+        // Each texture but the side texture has one layer per orientation of a batch
+
         // Front texture
-        glGenTextures(1, &s_frontTex_unorm);
-        glBindTexture(GL_TEXTURE_2D, s_frontTex_unorm);
+        glGenTextures(1, &m_frontTex_unorm);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, m_frontTex_unorm);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+        glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, emptyVal);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_RGBA8, m_texSize.x, m_texSize.y, m_batchCapacity);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+        // Front texture view
+        glGenTextures(1, &m_frontTex_uint);
+        glTextureView(m_frontTex_uint, GL_TEXTURE_2D_ARRAY, m_frontTex_unorm, GL_RGBA8UI, 0, 1, 0, m_batchCapacity);
+        // Front texture first layer view, for display
+        glGenTextures(1, &m_frontLayerTex);
+        glTextureView(m_frontLayerTex, GL_TEXTURE_2D, m_frontTex_unorm, GL_RGBA8, 0, 1, 0, 1);
+        glBindTexture(GL_TEXTURE_2D, m_frontLayerTex);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
         glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, emptyVal);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-        glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, s_texSize, s_texSize);
         glBindTexture(GL_TEXTURE_2D, 0);
-        // Front texture view
-        glGenTextures(1, &s_frontTex_uint);
-        glTextureView(s_frontTex_uint, GL_TEXTURE_2D, s_frontTex_unorm, GL_RGBA8UI, 0, 1, 0, 1);
 
         // Normal texture
-        glGenTextures(1, &s_normTex);
-        glBindTexture(GL_TEXTURE_2D, s_normTex);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-        glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, emptyVal);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-        glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA16_SNORM, s_texSize, s_texSize);
+        glGenTextures(1, &m_normTex);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, m_normTex);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+        glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, emptyVal);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, k_normFormat, m_texSize.x, m_texSize.y, m_batchCapacity);
 
         // Setup flag texture
-        glGenTextures(1, &s_flagTex);
-        glBindTexture(GL_TEXTURE_2D, s_flagTex);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-        glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, emptyVal);
-        glTexStorage2D(GL_TEXTURE_2D, 1, GL_R32UI, s_texSize, s_texSize);
+        glGenTextures(1, &m_flagTex);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, m_flagTex);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+        glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, emptyVal);
+        glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_R32UI, m_texSize.x, m_texSize.y, m_batchCapacity);
 
         // Turbulence texture
-        glGenTextures(1, &s_turbTex);
-        glBindTexture(GL_TEXTURE_2D, s_turbTex);
+        glGenTextures(1, &m_turbTex);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, m_turbTex);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+        glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, emptyVal);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_R8, m_texSize.x / 4, m_texSize.y / 4, m_batchCapacity);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+        // Turbulence texture first layer view, for display
+        glGenTextures(1, &m_turbLayerTex);
+        glTextureView(m_turbLayerTex, GL_TEXTURE_2D, m_turbTex, GL_R8, 0, 1, 0, 1);
+        glBindTexture(GL_TEXTURE_2D, m_turbLayerTex);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
         glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, emptyVal);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexStorage2D(GL_TEXTURE_2D, 1, GL_R8, s_texSize / 4, s_texSize / 4);
         glBindTexture(GL_TEXTURE_2D, 0);
 
         // Previous turbulence texture
-        glGenTextures(1, &s_prevTurbTex);
-        glBindTexture(GL_TEXTURE_2D, s_prevTurbTex);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-        glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, emptyVal);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexStorage2D(GL_TEXTURE_2D, 1, GL_R8, s_texSize / 4, s_texSize / 4);
-        glBindTexture(GL_TEXTURE_2D, 0);
+        glGenTextures(1, &m_prevTurbTex);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, m_prevTurbTex);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+        glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, emptyVal);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_R8, m_texSize.x / 4, m_texSize.y / 4, m_batchCapacity);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
 
         // Wind shadow texture
-        glGenTextures(1, &s_shadTex);
-        glBindTexture(GL_TEXTURE_2D, s_shadTex);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-        glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, emptyVal);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexStorage2D(GL_TEXTURE_2D, 1, GL_R8, s_texSize / 4, s_texSize / 4);
-        glBindTexture(GL_TEXTURE_2D, 0);
-
-        // Index texture
-        if (s_doCloth) {
-            glGenTextures(1, &s_indexTex);
-            glBindTexture(GL_TEXTURE_2D, s_indexTex);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-            glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, emptyVal);
-            glTexStorage2D(GL_TEXTURE_2D, 1, GL_R32UI, s_texSize, s_texSize);
-        }
+        glGenTextures(1, &m_shadTex);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, m_shadTex);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+        glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, emptyVal);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_R8, m_texSize.x / 4, m_texSize.y / 4, m_batchCapacity);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
 
         // Side texture
-        glGenTextures(1, &s_sideTex);
-        glBindTexture(GL_TEXTURE_2D, s_sideTex);
+        glGenTextures(1, &m_sideTex);
+        glBindTexture(GL_TEXTURE_2D, m_sideTex);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
         glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, emptyVal);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-        glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, s_texSize, s_texSize);
+        glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, m_texSize.x, m_texSize.y);
         glBindTexture(GL_TEXTURE_2D, 0);
 
+        // Distance field textures
+        glGenTextures(2, m_distTex);
+        for (int i(0); i < 2; ++i) {
+            glBindTexture(GL_TEXTURE_2D_ARRAY, m_distTex[i]);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_R8UI, m_texSize.x, m_texSize.y, m_batchCapacity);
+        }
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
         if (glGetError() != GL_NO_ERROR) {
             std::cerr << "OpenGL error" << std::endl;
             return false;
@@ -366,37 +574,34 @@ namespace rld {
         return true;
     }
 
-    static bool setupFramebuffer() {
+    bool Simulator::setupFramebuffer() {
         // Depth render buffer
-        u32 rb(0);
-        glGenRenderbuffers(1, &rb);
-        glBindRenderbuffer(GL_RENDERBUFFER, rb);
-        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT32, s_texSize, s_texSize);
+        glGenRenderbuffers(1, &m_depthRenderbuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, m_depthRenderbuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT32, m_texSize.x, m_texSize.y);
         glBindRenderbuffer(GL_RENDERBUFFER, 0);
 
-        // Create FBO
-        glGenFramebuffers(1, &s_fbo);
-        glBindFramebuffer(GL_FRAMEBUFFER, s_fbo);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, s_frontTex_uint, 0);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, s_normTex, 0);
-        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rb);
-        if (s_doCloth) {
-            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, s_indexTex, 0);
-            u32 drawBuffers[]{ GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
-            glDrawBuffers(3, drawBuffers);
-        }
-        else {
+        // Create an FBO for each layer. They share the depth buffer, as layers are rendered one at a time
+        m_fbos.resize(m_batchCapacity);
+        glGenFramebuffers(m_batchCapacity, m_fbos.data());
+        for (int layer(0); layer < m_batchCapacity; ++layer) {
+            glBindFramebuffer(GL_FRAMEBUFFER, m_fbos[layer]);
+            glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_frontTex_uint, 0, layer);
+            glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, m_normTex, 0, layer);
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depthRenderbuffer);
             u32 drawBuffers[]{ GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
             glDrawBuffers(2, drawBuffers);
-        }
 
-        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-            std::cerr << "Framebuffer is incomplete" << std::endl;
-            return false;
+            if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+                std::cerr << "Framebuffer is incomplete" << std::endl;
+                return false;
+            }
         }
 
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
+        setupIndexTexture(m_doCloth);
+
         if (glGetError() != GL_NO_ERROR) {
             std::cerr << "OpenGL error" << std::endl;
             return false;
@@ -405,82 +610,200 @@ namespace rld {
         return true;
     }
 
-    static void computeProspect() {
-        Shader & prospectShader(s_debug ? *s_prospectShaderDebug : *s_prospectShader);
+    // Creates the index texture and has the framebuffers draw to it as well, or deletes it. Only cloth and sub model
+    // attribution read it, so otherwise no memory or bandwidth is spent on it
+    void Simulator::setupIndexTexture(bool enable) {
+        if (enable == (m_indexTex != 0)) {
+            return;
+        }
+
+        if (enable) {
+            float emptyVal[4]{};
+            glGenTextures(1, &m_indexTex);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, m_indexTex);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+            glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, emptyVal);
+            glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_R32UI, m_texSize.x, m_texSize.y, m_batchCapacity);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+        }
+        else {
+            glDeleteTextures(1, &m_indexTex);
+            m_indexTex = 0;
+        }
+
+        for (int layer(0); layer < m_batchCapacity; ++layer) {
+            glBindFramebuffer(GL_FRAMEBUFFER, m_fbos[layer]);
+            glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, m_indexTex, 0, layer);
+            u32 drawBuffers[]{ GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
+            glDrawBuffers(m_indexTex ? 3 : 2, drawBuffers);
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    void Simulator::computeProspect() {
+        bool isCapture(m_geoCacheEntry && !m_isGeoReplay);
+        Shader & prospectShader(isCapture ? (m_debug ? *m_prospectShaderCaptureDebug : *m_prospectShaderCapture) : (m_debug ? *m_prospectShaderDebug : *m_prospectShader));
         prospectShader.bind();
 
-        // 8x8 work groups
-        glDispatchCompute((s_texSize + 7) / 8, (s_texSize + 7) / 8, 1);
+        // An 8x8 work group per tile of any layer with geometry in it, as listed by `renderGeometry`, in rows short
+        // enough for any implementation
+        glDispatchComputeIndirect(k_prospectDispatchStage * 3 * sizeof(u32));
         glMemoryBarrier(GL_ALL_BARRIER_BITS); // TODO: don't need all
     }
 
-    static void computeDraw() {
-        Shader & drawShader(s_debug ? *s_drawShaderDebug : *s_drawShader);
-        drawShader.bind();
-    
-        glDispatchCompute(1, 1, 1);
+    void Simulator::computeCompact() {
+        bool isCapture(m_geoCacheEntry && !m_isGeoReplay);
+        Shader & compactShader(isCapture ? *m_compactShaderCapture : *m_compactShader);
+        compactShader.bind();
+
+        // One work group per row, plus one to sum the results, for each layer
+        glDispatchCompute(1, m_constants->texSize.y + 1, m_batchSize);
         glMemoryBarrier(GL_ALL_BARRIER_BITS); // TODO: don't need all
     }
 
-    static void computeOutline() {
-        Shader & outlineShader(s_debug ? *s_outlineShaderDebug : *s_outlineShader);
-        outlineShader.bind();
-    
+    void Simulator::computeScatter() {
+        Shader & scatterShader(m_debug ? *m_scatterShaderDebug : *m_scatterShader);
+        scatterShader.bind();
+
+        int start(m_geoCacheEntry->sliceStarts[m_currentSlice]);
+        int count(m_geoCacheEntry->sliceStarts[m_currentSlice + 1] - start);
+        scatterShader.uniform("u_cacheStart", start);
+        scatterShader.uniform("u_cacheCount", count);
+        glDispatchCompute(1, 1, 1); // One work group, as only the first layer is ever cached
+        glMemoryBarrier(GL_ALL_BARRIER_BITS); // TODO: don't need all
+    }
+
+    void Simulator::computeDispatch(int stage) {
+        m_dispatchShader->bind();
+        m_dispatchShader->uniform("u_stage", stage);
+        m_dispatchShader->uniform("u_layerCount", m_batchSize);
         glDispatchCompute(1, 1, 1);
         glMemoryBarrier(GL_ALL_BARRIER_BITS); // TODO: don't need all
     }
 
-    static void computeMove() {
-        Shader & moveShader(s_debug ? *s_moveShaderDebug : *s_moveShader);
+    void Simulator::computeDraw() {
+        computeDispatch(k_drawDispatchStage);
+
+        Shader & drawShader(m_debug ? *m_drawShaderDebug : *m_drawShader);
+        drawShader.bind();
+
+        // A work group per block of each layer's previous air pixels, which claim pixels, count those kept, then append them
+        for (int phase(0); phase < 3; ++phase) {
+            drawShader.uniform("u_phase", phase);
+            glDispatchComputeIndirect(k_drawDispatchStage * 3 * sizeof(u32));
+            glMemoryBarrier(GL_ALL_BARRIER_BITS); // TODO: don't need all
+        }
+    }
+
+    void Simulator::computeDistance() {
+        m_distanceShader->bind();
+
+        ivec2 texSize(m_constants->texSize);
+        int passes(distPassCount(m_maxSearchDist / m_constants->pixelSize));
+        glActiveTexture(GL_TEXTURE3);
+        for (int pass(0); pass < passes; ++pass) {
+            // Each pass reads the last one's texture and writes the other
+            glBindTexture(GL_TEXTURE_2D_ARRAY, m_distTex[(pass + 1) % 2]);
+            glBindImageTexture(7, m_distTex[pass % 2], 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_R8UI);
+            m_distanceShader->uniform("u_pass", pass);
+            glDispatchCompute((texSize.x + 7) / 8, (texSize.y + 7) / 8, m_batchSize); // Must match shader
+            glMemoryBarrier(GL_ALL_BARRIER_BITS); // TODO: don't need all
+        }
+        glBindTexture(GL_TEXTURE_2D_ARRAY, m_distTex[(passes - 1) % 2]); // For `outline` and `move`
+        glActiveTexture(GL_TEXTURE0);
+
+        glBindImageTexture(7, m_sideTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA8);
+    }
+
+    void Simulator::computeOutline() {
+        computeDispatch(k_outlineDispatchStage);
+
+        Shader & outlineShader(m_debug ? *m_outlineShaderDebug : *m_outlineShader);
+        outlineShader.bind();
+
+        // A work group per block of each layer's geo pixels, which search, then spawn air once every search is done
+        for (int phase(0); phase < 2; ++phase) {
+            outlineShader.uniform("u_phase", phase);
+            glDispatchComputeIndirect(k_outlineDispatchStage * 3 * sizeof(u32));
+            glMemoryBarrier(GL_ALL_BARRIER_BITS); // TODO: don't need all
+        }
+    }
+
+    void Simulator::computeMove() {
+        computeDispatch(k_moveDispatchStage);
+
+        Shader & moveShader(m_debug ? *m_moveShaderDebug : *m_moveShader);
         moveShader.bind();
-    
-        glDispatchCompute(1, 1, 1);
+
+        glDispatchComputeIndirect(k_moveDispatchStage * 3 * sizeof(u32)); // A work group per block of each layer's air pixels
         glMemoryBarrier(GL_ALL_BARRIER_BITS); // TODO: don't need all
     }
 
-    static void computePretty() {
-        s_prettyShader->bind();
-        int n((s_texSize + 7) / 8);
-        glDispatchCompute(n, n, 1);
+    void Simulator::computePretty() {
+        m_prettyShader->bind();
+        ivec2 n((m_texSize + 7) / 8);
+        glDispatchCompute(n.x, n.y, 1); // Only the first layer is shown
         glMemoryBarrier(GL_ALL_BARRIER_BITS); // TODO: don't need all
     }
 
-    static void computeSide() {
-        glBindImageTexture(0, s_frontTex_unorm, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA8);
+    void Simulator::computeSide() {
+        glBindImageTexture(0, m_frontTex_unorm, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA8); // Just the first layer
 
-        s_sideShader->bind();
-        int sideX(int((-s_constants.sliceZ / s_windframeWidth + 0.5f) * float(s_texSize)));
-        s_sideShader->uniform("u_sideX", sideX);
-        glDispatchCompute(1, (s_texSize + 7) / 8, 1); // Must match shader
+        m_sideShader->bind();
+        int sideX(int((-m_constants->sliceZ / m_windframeSize.x + 0.5f) * float(m_texSize.x)));
+        m_sideShader->uniform("u_sideX", sideX);
+        glDispatchCompute(1, (m_texSize.y + 7) / 8, 1); // Must match shader
         glMemoryBarrier(GL_ALL_BARRIER_BITS); // TODO: don't need all
 
-        glBindImageTexture(0, s_frontTex_uint, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA8UI);
+        glBindImageTexture(0, m_frontTex_uint, 0, GL_TRUE, 0, GL_READ_WRITE, GL_RGBA8UI);
     }
 
-    static void renderGeometry() {
-        glBindFramebuffer(GL_FRAMEBUFFER, s_fbo);
-        glViewport(0, 0, s_texSize, s_texSize);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    void Simulator::renderGeometry() {
+        glViewport(0, 0, m_constants->texSize.x, m_constants->texSize.y);
 
-        Shader & foilShader(s_debug ? *s_foilShaderDebug : *s_foilShader);
+        Shader & foilShader(m_debug ? *m_foilShaderDebug : *m_foilShader);
         foilShader.bind();
 
-        float nearDist(s_windframeDepth * -0.5f + s_currentSlice * s_sliceSize);
-        float windframeRadius(s_windframeWidth * 0.5f);
+        float nearDist(-m_constants->sliceZ);
+        vec2 windframeRadius(m_constants->windframeSize * 0.5f);
+        vec2 windframeCenter(m_constants->windframeCenter);
         mat4 projMat(glm::ortho(
-            -windframeRadius, // left
-            windframeRadius,  // right
-            -windframeRadius, // bottom
-            windframeRadius,  // top
+            windframeCenter.x - windframeRadius.x, // left
+            windframeCenter.x + windframeRadius.x, // right
+            windframeCenter.y - windframeRadius.y, // bottom
+            windframeCenter.y + windframeRadius.y, // top
             nearDist, // near
-            nearDist + s_sliceSize // far
+            nearDist + m_constants->sliceSize // far
         ));
         foilShader.uniform("u_projMat", projMat);
 
-        glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-        s_model->draw(s_modelMat, s_normalMat, foilShader.uniformLocation("u_modelMat"), foilShader.uniformLocation("u_normalMat"));
-        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-        s_model->draw(s_modelMat, s_normalMat, foilShader.uniformLocation("u_modelMat"), foilShader.uniformLocation("u_normalMat"));
+        // Each orientation into its own layer
+        for (int layer(0); layer < m_batchSize; ++layer) {
+            const mat4 & modelMat(m_batchModelMats.empty() ? m_modelMat : m_batchModelMats[layer]);
+            const mat3 & normalMat(m_batchNormalMats.empty() ? m_normalMat : m_batchNormalMats[layer]);
+
+            glBindFramebuffer(GL_FRAMEBUFFER, m_fbos[layer]);
+            glClear(GL_DEPTH_BUFFER_BIT); // The front texture is stamped with the slice's epoch instead of cleared
+            foilShader.uniform("u_layer", layer);
+
+            // Cloth moves every frame, so is always drawn whole
+            if (m_slabIndices.empty()) {
+                glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+                m_model->draw(modelMat, normalMat, foilShader.uniformLocation("u_modelMat"), foilShader.uniformLocation("u_normalMat"));
+                glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+                m_model->draw(modelMat, normalMat, foilShader.uniformLocation("u_modelMat"), foilShader.uniformLocation("u_normalMat"));
+            }
+            // Otherwise only the triangles crossing the slice
+            else {
+                SlabIndex & slabIndex(*m_slabIndices[layer]);
+                slabIndex.update(*m_model, modelMat, m_windframeDepth, m_sliceCount >> m_level, m_sliceDepths);
+                glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+                slabIndex.draw(m_currentSlice, modelMat, normalMat, foilShader.uniformLocation("u_modelMat"), foilShader.uniformLocation("u_normalMat"), foilShader.uniformLocation("u_subModelI"));
+                glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+                slabIndex.draw(m_currentSlice, modelMat, normalMat, foilShader.uniformLocation("u_modelMat"), foilShader.uniformLocation("u_normalMat"), foilShader.uniformLocation("u_subModelI"));
+            }
+        }
 
         glMemoryBarrier(GL_ALL_BARRIER_BITS); // TODO: don't need all
 
@@ -489,313 +812,1848 @@ namespace rld {
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
     }
 
-    static void uploadConstants() {
-        glBindBuffer(GL_UNIFORM_BUFFER, s_constantsBuffer);
-        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(Constants), &s_constants);
+    void Simulator::uploadConstants() {
+        glBindBuffer(GL_UNIFORM_BUFFER, m_constantsBuffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(Constants), m_constants.get());
         glBindBuffer(GL_UNIFORM_BUFFER, 0);
     }
 
-    static void resetCounters(bool both) {
+    void Simulator::resetCounters(bool both) {
         s32 zero(0);
-        glBindBuffer(GL_SHADER_STORAGE_BUFFER, s_geoPixelsBuffer);
-        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(s32), &zero);
-        if (s_swap == 0 || both) {
-            glBindBuffer(GL_SHADER_STORAGE_BUFFER, s_airPixelsBuffer[0]);
-            glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(s32), &zero);
+        s64 countsSize(pixelCountsSize(m_batchCapacity));
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_geoPixelsBuffer);
+        glClearBufferSubData(GL_SHADER_STORAGE_BUFFER, GL_R32I, 0, countsSize, GL_RED_INTEGER, GL_INT, &zero);
+        if (m_swap == 0 || both) {
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_airPixelsBuffer[0]);
+            glClearBufferSubData(GL_SHADER_STORAGE_BUFFER, GL_R32I, 0, countsSize, GL_RED_INTEGER, GL_INT, &zero);
         }
-        if (s_swap == 1 || both) {
-            glBindBuffer(GL_SHADER_STORAGE_BUFFER, s_airPixelsBuffer[1]);
-            glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(s32), &zero);
+        if (m_swap == 1 || both) {
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_airPixelsBuffer[1]);
+            glClearBufferSubData(GL_SHADER_STORAGE_BUFFER, GL_R32I, 0, countsSize, GL_RED_INTEGER, GL_INT, &zero);
         }
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_rowCountsBuffer);
+        glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32I, GL_RED_INTEGER, GL_INT, &zero);
+        // Prospect's work group counts and its tile count, which `renderGeometry` counts up as it lists tiles
+        s32 one(1);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_dispatchBuffer);
+        glClearBufferSubData(GL_SHADER_STORAGE_BUFFER, GL_R32I, k_prospectDispatchStage * 3 * sizeof(u32), sizeof(u32), GL_RED_INTEGER, GL_INT, &zero);
+        glClearBufferSubData(GL_SHADER_STORAGE_BUFFER, GL_R32I, (k_prospectDispatchStage * 3 + 1) * sizeof(u32), sizeof(u32), GL_RED_INTEGER, GL_INT, &one);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_tilesBuffer);
+        glClearBufferSubData(GL_SHADER_STORAGE_BUFFER, GL_R32I, 0, sizeof(s32), GL_RED_INTEGER, GL_INT, &zero);
         glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
     }
 
-    static void clearResults() {
-        glBindBuffer(GL_SHADER_STORAGE_BUFFER, s_resultsBuffer);
+    void Simulator::clearResults() {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_resultsBuffer);
         vec4 zero;
         glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_RGBA32F, GL_RGBA, GL_FLOAT, &zero);
         glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
     }
 
-    static void downloadResults() {
-        glBindBuffer(GL_SHADER_STORAGE_BUFFER, s_resultsBuffer);
-        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, s_sliceCount * sizeof(Result), s_results.data());
+    // Zeroes the sub model results, first growing the buffer if the model has more sub models than it fits
+    void Simulator::clearSubModelResults() {
+        s64 size(s64(m_sliceCount) * m_constants->subModelCount * sizeof(Result));
+        if (size > m_subModelResultsSize) {
+            glDeleteBuffers(1, &m_subModelResultsBuffer);
+            glGenBuffers(1, &m_subModelResultsBuffer);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_subModelResultsBuffer);
+            glBufferStorage(GL_SHADER_STORAGE_BUFFER, size, nullptr, GL_DYNAMIC_STORAGE_BIT);
+            m_subModelResultsSize = size;
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 10, m_subModelResultsBuffer);
+        }
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_subModelResultsBuffer);
+        vec4 zero;
+        glClearBufferSubData(GL_SHADER_STORAGE_BUFFER, GL_RGBA32F, 0, size, GL_RGBA, GL_FLOAT, &zero);
         glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
 
-        s_result.lift = vec3();
-        s_result.drag = vec3();
-        s_result.torq = vec3();
-        for (const Result & result : s_results) {
-            s_result.lift += result.lift;
-            s_result.drag += result.drag;
-            s_result.torq += result.torq;
-        }
-    }
-
-    static void resetConstants() {
-        s_constants.maxGeoPixels = s_maxGeoPixels;
-        s_constants.maxAirPixels = s_maxAirPixels;
-        s_constants.texSize = s_texSize;
-        s_constants.liftC = s_liftC;
-        s_constants.dragC = s_dragC;
-        s_constants.windframeSize = s_windframeWidth;
-        s_constants.windframeDepth = s_windframeDepth;
-        s_constants.sliceSize = s_sliceSize;
-        s_constants.turbulenceDist = s_turbulenceDist;
-        s_constants.maxSearchDist = s_maxSearchDist;
-        s_constants.windShadDist = s_windShadDist;
-        s_constants.backforceC = s_backforceC;
-        s_constants.flowback = s_flowback;
-        s_constants.initVelC = s_initVelC;
-        s_constants.windSpeed = s_windSpeed;
-        s_constants.dt = s_dt;
-        s_constants.slice = 0;
-        s_constants.sliceZ = s_windframeDepth * -0.5f;
-        s_constants.pixelSize = s_windframeWidth / float(s_texSize);
-    }
-
-    static void clearTurbTex() {
-        vec4 clearVal;
-        glClearTexImage(s_turbTex, 0, GL_RED, GL_UNSIGNED_BYTE, &clearVal);
+    void Simulator::clearStats() {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_statsBuffer);
+        s32 zero(0);
+        glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32I, GL_RED_INTEGER, GL_INT, &zero);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
     }
 
-    static void clearShadTex() {
-        vec4 clearVal;
-        glClearTexImage(s_shadTex, 0, GL_RED, GL_UNSIGNED_BYTE, &clearVal);
+    void Simulator::markStage(ProfileStage stage) {
+        if (m_profiler) m_profiler->mark(stage);
     }
 
-    static void clearFlagTex() {
-        vec4 clearVal;
-        glClearTexImage(s_flagTex, 0, GL_RED_INTEGER, GL_UNSIGNED_INT, &clearVal);
+    void Simulator::sumResults() {
+        m_result.lift = vec3();
+        m_result.drag = vec3();
+        m_result.torq = vec3();
+        m_result.geoCount = 0;
+        m_result.airCount = 0;
+        for (const Result & result : m_results) {
+            m_result.lift += result.lift;
+            m_result.drag += result.drag;
+            m_result.torq += result.torq;
+            m_result.geoCount = glm::max(m_result.geoCount, result.geoCount);
+            m_result.airCount = glm::max(m_result.airCount, result.airCount);
+        }
     }
 
-    static void clearSideTex() {
-        vec4 clearVal;
-        glClearTexImage(s_sideTex, 0, GL_RGBA, GL_UNSIGNED_BYTE, &clearVal);
-    }
-
-    static void setBindings() {
-        glBindBufferBase(GL_UNIFORM_BUFFER, 0, s_constantsBuffer);
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, s_geoPixelsBuffer);
-        //glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, s_airPixelsBuffer[s_swap]);       // done in step()
-        //glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, s_airPixelsBuffer[1 - s_swap]);   // done in step()
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, s_airGeoMapBuffer);
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, s_resultsBuffer);
-        if (s_doCloth) {
-            const SoftMesh & softMesh(static_cast<const SoftMesh &>(s_model->subModels().front().mesh()));
-            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, softMesh.vertexBuffer());
-            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, softMesh.indexBuffer());
+    // Folds the times of any of `stepFor`'s calls that have arrived into the running average of a slice's cost
+    void Simulator::collectSliceTimers() {
+        for (SliceTimer & timer : m_sliceTimers) {
+            if (!timer.sliceCount) {
+                continue;
+            }
+
+            u32 isAvailable(0);
+            glGetQueryObjectuiv(timer.query, GL_QUERY_RESULT_AVAILABLE, &isAvailable);
+            if (!isAvailable) {
+                continue;
+            }
+
+            u64 nanoseconds(0);
+            glGetQueryObjectui64v(timer.query, GL_QUERY_RESULT, &nanoseconds);
+            float cost(float(nanoseconds) * 1.0e-3f / float(timer.sliceCount));
+            m_sliceCost = m_sliceCost > 0.0f ? glm::mix(m_sliceCost, cost, k_sliceCostWeight) : cost;
+            timer.sliceCount = 0;
         }
+    }
 
-        glBindImageTexture(0,  s_frontTex_uint, 0, GL_FALSE, 0, GL_READ_WRITE,      GL_RGBA8UI);
-        glBindImageTexture(1,        s_normTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA16_SNORM);
-        glBindImageTexture(2,        s_flagTex, 0, GL_FALSE, 0, GL_READ_WRITE,         GL_R32I);
-        glBindImageTexture(3,        s_turbTex, 0, GL_FALSE, 0, GL_READ_WRITE,           GL_R8);
-        glBindImageTexture(4,    s_prevTurbTex, 0, GL_FALSE, 0, GL_READ_WRITE,           GL_R8);
-        glBindImageTexture(5,        s_shadTex, 0, GL_FALSE, 0, GL_READ_WRITE,           GL_R8);
-        if (s_doCloth) {
-            glBindImageTexture(6,   s_indexTex, 0, GL_FALSE, 0, GL_READ_WRITE,        GL_R32UI);
+    void Simulator::downloadResults() {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_resultsBuffer);
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, m_batchSize * m_sliceCount * sizeof(Result), m_batchResults.data());
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        if (m_isMirrored) mirrorResults(m_batchResults.data(), m_batchSize * m_sliceCount);
+
+        // The first layer's results are the sweep's results
+        std::copy_n(m_batchResults.begin(), m_sliceCount, m_results.begin());
+        if (m_level) spreadResults(m_results.data(), 1, m_level);
+        m_resultLevel = m_level;
+        sumResults();
+
+        m_subModelResults.resize(m_sliceCount * m_constants->subModelCount);
+        if (m_constants->subModelCount) {
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_subModelResultsBuffer);
+            glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, m_subModelResults.size() * sizeof(Result), m_subModelResults.data());
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+            if (m_level) spreadResults(m_subModelResults.data(), m_constants->subModelCount, m_level);
         }
-        glBindImageTexture(7,        s_sideTex, 0, GL_FALSE, 0, GL_READ_WRITE,        GL_RGBA8);
 
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, s_turbTex);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, s_prevTurbTex);
-        glActiveTexture(GL_TEXTURE2);
-        glBindTexture(GL_TEXTURE_2D, s_shadTex);
+        // Not spread, as counts of coarse slices say nothing of the fine slices they cover
+        m_stats.resize(m_sliceCount >> m_level);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_statsBuffer);
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, m_stats.size() * sizeof(SliceStats), m_stats.data());
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
     }
 
+    // Copies the results into the next slot of the readback ring, where `tryResult` will find them once they arrive
+    void Simulator::queueResults() {
+        ResultsReadback & readback(m_readbacks[++m_lastTicket % m_readbacks.size()]);
+        readback.ticket = m_lastTicket;
+
+        if (m_backend == Backend::cpu) {
+            readback.cpuResults = m_results; // Already mirrored and spread
+            readback.results = readback.cpuResults.data();
+            readback.cpuStats = m_stats;
+            readback.stats = readback.cpuStats.data();
+            readback.isMirrored = false;
+            readback.level = m_resultLevel;
+            return;
+        }
+        readback.isMirrored = m_isMirrored;
+        readback.level = m_level;
+
+        // Any results still in the slot are dropped
+        glDeleteSync(static_cast<GLsync>(readback.fence));
+
+        glBindBuffer(GL_COPY_READ_BUFFER, m_resultsBuffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, readback.buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, m_sliceCount * sizeof(Result));
+        glBindBuffer(GL_COPY_READ_BUFFER, m_statsBuffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, m_sliceCount * sizeof(Result), m_sliceCount * sizeof(SliceStats));
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glFlush(); // Otherwise the fence may never be signaled while polling
+    }
 
+    void Simulator::resetConstants() {
+        m_constants->maxGeoPixels = m_maxGeoPixels;
+        m_constants->maxAirPixels = m_maxAirPixels;
+        m_constants->texSize = m_texSize;
+        m_constants->liftC = m_liftC;
+        m_constants->dragC = m_dragC;
+        m_constants->windframeDepth = m_windframeDepth;
+        m_constants->sliceSize = m_sliceSize;
+        m_constants->turbulenceDist = m_turbulenceDist;
+        m_constants->maxSearchDist = m_maxSearchDist;
+        m_constants->windShadDist = m_windShadDist;
+        m_constants->backforceC = m_backforceC;
+        m_constants->flowback = m_flowback;
+        m_constants->initVelC = m_initVelC;
+        m_constants->windSpeed = m_windSpeed;
+        m_constants->dt = m_dt;
+        m_constants->slice = 0;
+        m_constants->sliceZ = m_windframeDepth * -0.5f;
+        // Only sweeps of one orientation whose results are downloaded attribute, and never mirrored ones, as a sub
+        // model's mirror image is another sub model
+        bool isAttributing(m_isAttributing && !m_isMirrored && m_batchModelMats.empty() && !m_isAsyncSweep);
+        m_constants->subModelCount = isAttributing ? int(m_model->subModelCount()) : 0;
+    }
 
-    bool setup(
-        const int texSize,
-        int sliceCount,
-        float liftC,
-        float dragC,
-        float turbulenceDist,
-        float maxSearchDist,
-        float windShadDist,
-        float backforceC,
-        float flowback,
-        float initVelC,
-        bool doSide,
-        bool doCloth
-    ) {
-        int coreCount(0);
-        if (k_useAllCores) glGetIntegerv(GL_MAX_COMPUTE_WORK_GROUP_INVOCATIONS, &coreCount);
-        else coreCount = k_coresToUse;
-        int warpCount(coreCount / k_warpSize);
-        s_workGroupSize = warpCount * k_warpSize; // we want workgroups to be a warp multiple
-        // If doing 2D operations within 1D compute shaders, s_workGroupSize must instead defines as such
-        //s_workGroupSize2D.x = int(std::round(std::sqrt(float(warpCount))));
-        //s_workGroupSize2D.y = warpCount / s_workGroupSize2D.x;
-        //s_workGroupSize2D *= k_warpSize2D;
-        //s_workGroupSize = s_workGroupSize2D.x * s_workGroupSize2D.y; // match 1d group size to 2d so can use interchangeably in shaders
-
-        s_texSize = texSize;
-        s_maxGeoPixels = s_texSize * s_texSize / k_maxPixelsDivisor;
-        s_maxAirPixels = s_maxGeoPixels;
-        s_sliceCount = sliceCount;
-        s_liftC = liftC;
-        s_dragC = dragC;
-        setVariables(
-            turbulenceDist,
-            maxSearchDist,
-            windShadDist,
-            backforceC,
-            flowback,
-            initVelC
-        );
-        s_doSide = doSide;
-        s_doCloth = doCloth;
+    // Places the current tile within the windframe. Without tiling, the tile is the whole windframe, or its half at
+    // x >= 0 when mirrored. Below full resolution, only a corner of the textures is used, each pixel covering more
+    void Simulator::resetTileConstants() {
+        ivec2 core(m_texSize - 2 * m_tileHalo);
+        ivec2 texSize(effectiveTexSize());
+        ivec2 levelTexSize(m_texSize >> m_level);
+        ivec2 tile(m_tiles[m_currentTile] % m_tileCount.x, m_tiles[m_currentTile] / m_tileCount.x);
+        float pixelSize(m_windframeSize.x / float(texSize.x >> m_level));
+        m_constants->pixelSize = pixelSize;
+        m_constants->isMirrored = m_isMirrored;
+
+        // Only the first half of each row of the textures is used, so the left edge is at x = 0
+        if (m_isMirrored) {
+            m_constants->texSize = ivec2(levelTexSize.x / 2, levelTexSize.y);
+            m_constants->windframeSize = vec2(float(m_constants->texSize.x) * pixelSize, m_windframeSize.y);
+            m_constants->windframeCenter = vec2(m_constants->windframeSize.x * 0.5f, 0.0f);
+            m_constants->coreMin = ivec2(0);
+            m_constants->coreMax = m_constants->texSize;
+            return;
+        }
 
-        s_results.resize(s_sliceCount);
+        m_constants->texSize = levelTexSize;
+        m_constants->windframeSize = m_windframeSize * (vec2(m_texSize) / vec2(texSize));
+        m_constants->windframeCenter = (vec2(tile * core - m_tileHalo) + (vec2(m_texSize) - vec2(texSize)) * 0.5f) * pixelSize;
+        m_constants->coreMin = ivec2(m_tileHalo);
+        m_constants->coreMax = levelTexSize - m_tileHalo;
+    }
 
-        // Setup shaders
-        if (!setupShaders()) {
-            std::cerr << "Failed to setup shaders" << std::endl;
-            return false;
+    // Places the current slice within the windframe. Slices spaced adaptively each have their own size and time step
+    void Simulator::resetSliceConstants() {
+        m_constants->slice = m_currentSlice;
+        if (m_sliceDepths.empty()) {
+            m_constants->sliceZ = m_windframeDepth * 0.5f - m_currentSlice * m_sliceSize;
+            return;
         }
 
-        // Setup buffers
-        if (!setupBuffers()) {
-            std::cerr << "Failed to setup buffers" << std::endl;
-            return false;
-        }
+        float front(m_sliceDepths[m_currentSlice]), back(m_sliceDepths[m_currentSlice + 1]);
+        m_constants->sliceZ = m_windframeDepth * 0.5f - front;
+        m_constants->sliceSize = back - front;
+        m_constants->dt = m_constants->sliceSize / m_windSpeed;
+    }
 
-        // Setup textures
-        if (!setupTextures()) {
-            std::cerr << "Failed to setup textures" << std::endl;
-            return false;
-        }
+    void Simulator::clearTurbTex() {
+        vec4 clearVal;
+        glClearTexImage(m_turbTex, 0, GL_RED, GL_UNSIGNED_BYTE, &clearVal);
+    }
 
-        // Setup framebuffer
-        if (!setupFramebuffer()) {
-            std::cerr << "Failed to setup framebuffer" << std::endl;
-            return false;
-        }
+    void Simulator::clearShadTex() {
+        vec4 clearVal;
+        glClearTexImage(m_shadTex, 0, GL_RED, GL_UNSIGNED_BYTE, &clearVal);
+    }
 
-        return true;
+    void Simulator::clearFlagTex() {
+        vec4 clearVal;
+        glClearTexImage(m_flagTex, 0, GL_RED_INTEGER, GL_UNSIGNED_INT, &clearVal);
     }
 
-    void setVariables(float turbulenceDist, float maxSearchDist, float windShadDist, float backforceC, float flowback, float initVelC) {
-        s_turbulenceDist = turbulenceDist;
-        s_maxSearchDist = maxSearchDist;
-        s_windShadDist = windShadDist;
-        s_backforceC = backforceC;
-        s_flowback = flowback;
-        s_initVelC = initVelC;
+    void Simulator::clearTileEpochs() {
+        s32 zero(0);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_tileEpochsBuffer);
+        glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32I, GL_RED_INTEGER, GL_INT, &zero);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
     }
 
-    void set(
-        const Model & model,
-        const mat4 & modelMat,
-        const mat3 & normalMat,
-        float windframeWidth,
-        float windframeDepth,
-        float windSpeed,
-        bool debug
-    ) {
-        s_model = &model;
-        s_modelMat = modelMat;
-        s_normalMat = normalMat;
-        s_windframeWidth = windframeWidth;
-        s_windframeDepth = windframeDepth;
-        s_sliceSize = s_windframeDepth / s_sliceCount;
-        s_windSpeed = windSpeed;
-        s_dt = s_sliceSize / s_windSpeed;
-        s_debug = debug;
+    void Simulator::clearSideTex() {
+        vec4 clearVal;
+        glClearTexImage(m_sideTex, 0, GL_RGBA, GL_UNSIGNED_BYTE, &clearVal);
     }
 
-    bool step(bool isExternalCall) {
-        // Reset for new sweep
-        if (s_currentSlice == 0) {
-            resetConstants();
-            resetCounters(true);
-            clearTurbTex();
-            clearShadTex();
-            clearResults();
-            if (s_debug && s_doSide) clearSideTex();
-            s_swap = 1;
+    void Simulator::clearFrontTex() {
+        vec4 clearVal;
+        glClearTexImage(m_frontTex_uint, 0, GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, &clearVal);
+    }
+
+    void Simulator::setBindings() {
+        glBindBufferBase(GL_UNIFORM_BUFFER, 0, m_constantsBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_geoPixelsBuffer);
+        //glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_airPixelsBuffer[m_swap]);       // done in step()
+        //glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_airPixelsBuffer[1 - m_swap]);   // done in step()
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, m_airGeoMapBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, m_resultsBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 8, m_rowCountsBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 9, m_blockResultsBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 10, m_subModelResultsBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 11, m_statsBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 12, m_dispatchBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 13, m_blockCountsBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 14, m_tileEpochsBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 15, m_tilesBuffer);
+        glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, m_dispatchBuffer);
+        if (m_doCloth) {
+            const SoftMesh & softMesh(static_cast<const SoftMesh &>(m_model->subModels().front().mesh()));
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, softMesh.vertexBuffer());
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, softMesh.indexBuffer());
         }
 
-        s_swap = 1 - s_swap;
+        glBindImageTexture(0,  m_frontTex_uint, 0,  GL_TRUE, 0, GL_READ_WRITE,      GL_RGBA8UI);
+        glBindImageTexture(1,        m_normTex, 0,  GL_TRUE, 0, GL_READ_WRITE, k_normFormat);
+        glBindImageTexture(2,        m_flagTex, 0,  GL_TRUE, 0, GL_READ_WRITE,         GL_R32I);
+        glBindImageTexture(3,        m_turbTex, 0,  GL_TRUE, 0, GL_READ_WRITE,           GL_R8);
+        glBindImageTexture(4,    m_prevTurbTex, 0,  GL_TRUE, 0, GL_READ_WRITE,           GL_R8);
+        glBindImageTexture(5,        m_shadTex, 0,  GL_TRUE, 0, GL_READ_WRITE,           GL_R8);
+        glBindImageTexture(6,       m_indexTex, 0,  GL_TRUE, 0, GL_READ_WRITE,        GL_R32UI);
+        glBindImageTexture(7,        m_sideTex, 0, GL_FALSE, 0, GL_READ_WRITE,        GL_RGBA8);
 
-        s_constants.slice = s_currentSlice;
-        s_constants.sliceZ = s_windframeDepth * 0.5f - s_currentSlice * s_sliceSize;
-        uploadConstants();
-        resetCounters(false);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, m_turbTex);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, m_prevTurbTex);
+        glActiveTexture(GL_TEXTURE2);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, m_shadTex);
+    }
 
-        if (isExternalCall) setBindings();
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, s_airPixelsBuffer[s_swap]);
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, s_airPixelsBuffer[1 - s_swap]);
+    bool Simulator::stepCPU() {
+        // Reset for new sweep
+        if (m_currentSlice == 0 && m_currentTile == 0) {
+            resetConstants();
+            beginCheckpoints();
+            beginGeometryCache();
+            m_sweepResults.assign(m_sliceCount, Result{});
+            m_sweepSubModelResults.assign(m_sliceCount * m_constants->subModelCount, Result{});
+            m_sweepStats.assign(m_sliceCount >> m_level, SliceStats{});
+        }
+        // Reset for new tile
+        if (m_currentSlice == 0) {
+            resetTileConstants();
+            m_cpuBackend->reset();
+            m_currentSlice = m_firstSlice;
+            if (m_resumeCheckpoint) restoreCheckpoint();
+        }
+        if (m_isCheckpointSweep) saveCheckpoint();
 
-        clearFlagTex();
-        renderGeometry(); // Render geometry to fbo
-        computeProspect(); // Scan fbo and generate geo pixels
-        glCopyImageSubData(s_turbTex, GL_TEXTURE_2D, 0, 0, 0, 0, s_prevTurbTex, GL_TEXTURE_2D, 0, 0, 0, 0, s_texSize / 4, s_texSize / 4, 1); // copy turb tex to prev turb tex
-        computeDraw(); // Draw any existing air pixels to the fbo and save their indices in the flag texture
-        computeOutline(); // Map air pixels to geometry, and generate new air pixels and draw them to the fbo
-        computeMove(); // Calculate lift/drag and move any existing air pixels in relation to the geometry
-        if (s_debug) computePretty(); // transforms the contents of the fbo, turb, and shad textures into a comprehensible front and side view
-        if (s_debug && s_doSide) computeSide(); // Projects the front texture onto one column of the side texture
-        Shader::unbind();
+        resetSliceConstants();
+        if (m_isGeoReplay) m_cpuBackend->replay(*m_constants, *m_geoCacheEntry);
+        else m_cpuBackend->step(*m_constants, *m_model, m_modelMat, m_normalMat, m_geoCacheEntry);
 
-        ++s_currentSlice;
+        ++m_currentSlice;
 
         // Was last slice
-        if (s_currentSlice >= s_sliceCount) {
-            if (!s_doCloth) downloadResults();
-
-            s_currentSlice = 0;
+        if (m_currentSlice >= m_endSlice) {
+            const std::vector<Result> & tileResults(m_cpuBackend->results());
+            for (int slice(0); slice < m_sliceCount; ++slice) {
+                m_sweepResults[slice].lift += tileResults[slice].lift;
+                m_sweepResults[slice].drag += tileResults[slice].drag;
+                m_sweepResults[slice].torq += tileResults[slice].torq;
+                m_sweepResults[slice].geoCount = glm::max(m_sweepResults[slice].geoCount, tileResults[slice].geoCount);
+                m_sweepResults[slice].airCount = glm::max(m_sweepResults[slice].airCount, tileResults[slice].airCount);
+            }
+            const std::vector<Result> & tileSubModelResults(m_cpuBackend->subModelResults());
+            for (size_t resultI(0); resultI < m_sweepSubModelResults.size(); ++resultI) {
+                m_sweepSubModelResults[resultI].lift += tileSubModelResults[resultI].lift;
+                m_sweepSubModelResults[resultI].drag += tileSubModelResults[resultI].drag;
+                m_sweepSubModelResults[resultI].torq += tileSubModelResults[resultI].torq;
+            }
+            const std::vector<SliceStats> & tileStats(m_cpuBackend->stats());
+            for (size_t slice(0); slice < m_sweepStats.size(); ++slice) {
+                SliceStats & stats(m_sweepStats[slice]);
+                stats.geoCount = glm::max(stats.geoCount, tileStats[slice].geoCount);
+                stats.airCount = glm::max(stats.airCount, tileStats[slice].airCount);
+                stats.geoOverflow += tileStats[slice].geoOverflow;
+                stats.airOverflow += tileStats[slice].airOverflow;
+                stats.searchSteps += tileStats[slice].searchSteps;
+                stats.turbulenceHits += tileStats[slice].turbulenceHits;
+            }
+
+            // Move on to the next tile
+            if (m_currentTile + 1 < int(m_tiles.size())) {
+                ++m_currentTile;
+                m_currentSlice = 0;
+                return false;
+            }
+
+            // Only now do the results change, so they're always those of a complete sweep
+            if (m_isMirrored) mirrorResults(m_sweepResults.data(), m_sliceCount);
+            if (m_level) {
+                spreadResults(m_sweepResults.data(), 1, m_level);
+                spreadResults(m_sweepSubModelResults.data(), m_constants->subModelCount, m_level);
+            }
+            std::swap(m_results, m_sweepResults);
+            std::swap(m_subModelResults, m_sweepSubModelResults);
+            std::swap(m_stats, m_sweepStats);
+            m_resultLevel = m_level;
+            sumResults();
+            endGeometryCache();
+            endCheckpoints();
+
+            // The next sweep refines this one
+            if (m_level) {
+                --m_level;
+                applyLevel();
+            }
+
+            m_currentSlice = 0;
+            m_currentTile = 0;
             return true;
         }
 
         return false;
     }
 
-    void sweep() {
-        s_currentSlice = 0;
-        setBindings();
-        while (!step(false));
-    }
+    void Simulator::beginGeometryCache() {
+        m_geoCacheEntry = nullptr;
+        m_isGeoReplay = false;
+        if (!m_isGeoCaching || m_doCloth || !m_batchModelMats.empty() || m_tiles.size() > 1 || m_constants->subModelCount || m_resumeCheckpoint || m_level) {
+            return;
+        }
 
-    void reset() {
-        s_currentSlice = 0;
-    }
+        GeometryKey key(geometryKey());
 
-    int slice() {
-        return s_currentSlice;
-    }
+        // Look for an existing entry
+        for (auto it(m_geoCache.begin()); it != m_geoCache.end(); ++it) {
+            if ((*it)->isValid && (*it)->key == key) {
+                std::rotate(m_geoCache.begin(), it, it + 1);
+                m_geoCacheEntry = m_geoCache.front().get();
+                m_isGeoReplay = true;
+                return;
+            }
+        }
 
-    int sliceCount() {
-        return s_sliceCount;
+        // Otherwise capture into a new entry, or the least recently used one
+        if (int(m_geoCache.size()) < k_maxGeoCacheEntries) {
+            m_geoCache.emplace(m_geoCache.begin(), new GeometryCacheEntry{});
+            if (m_backend == Backend::gpu) {
+                glGenBuffers(1, &m_geoCache.front()->pixelsBuffer);
+                glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_geoCache.front()->pixelsBuffer);
+                glBufferStorage(GL_SHADER_STORAGE_BUFFER, 4 * sizeof(s32) + s64(m_geoCacheCapacity) * sizeof(CachedPixel), nullptr, GL_DYNAMIC_STORAGE_BIT);
+                glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+            }
+        }
+        else {
+            std::rotate(m_geoCache.begin(), m_geoCache.end() - 1, m_geoCache.end());
+        }
+        m_geoCacheEntry = m_geoCache.front().get();
+        m_geoCacheEntry->key = std::move(key);
+        m_geoCacheEntry->isValid = false;
+        m_geoCacheEntry->sliceStarts.assign(m_sliceCount + 1, 0);
+        m_geoCacheEntry->results.assign(m_sliceCount, Result{});
+        m_geoCacheEntry->pixels.clear();
+
+        if (m_backend == Backend::gpu) {
+            s32 prefix[2]{ 0, m_geoCacheCapacity };
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_geoCacheEntry->pixelsBuffer);
+            glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(prefix), prefix);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        }
     }
 
-    const Result & result() {
-        return s_result;
+    // Copies the cache's pixel count, which is the index the current slice will start at
+    void Simulator::recordSliceStart() {
+        glBindBuffer(GL_COPY_READ_BUFFER, m_geoCacheEntry->pixelsBuffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, m_sliceStartsBuffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, m_currentSlice * sizeof(s32), sizeof(s32));
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
     }
 
-    const std::vector<Result> & results() {
-        return s_results;
+    // Copies the current slice's result, which only has drag and torque from drag before air is moved
+    void Simulator::recordSliceResult() {
+        glBindBuffer(GL_COPY_READ_BUFFER, m_resultsBuffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, m_geoResultsBuffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, m_currentSlice * sizeof(Result), m_currentSlice * sizeof(Result), sizeof(Result));
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
     }
 
-    u32 frontTex() {
-        return s_frontTex_unorm;
-    }
+    // Called after the last slice, once the results are downloaded
+    void Simulator::endGeometryCache() {
+        if (!m_geoCacheEntry) {
+            return;
+        }
+        if (m_isGeoReplay) {
+            m_geoCacheEntry = nullptr;
+            m_isGeoReplay = false;
+            return;
+        }
+
+        if (m_backend == Backend::gpu) {
+            recordSliceStart(); // `m_currentSlice` is now one past the last slice
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_sliceStartsBuffer);
+            glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, (m_sliceCount + 1) * sizeof(s32), m_geoCacheEntry->sliceStarts.data());
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_geoResultsBuffer);
+            glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, m_sliceCount * sizeof(Result), m_geoCacheEntry->results.data());
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+            // Skipped slices were never written, and hold whatever an earlier sweep left
+            std::fill(m_geoCacheEntry->results.begin(), m_geoCacheEntry->results.begin() + m_firstSlice, Result{});
+            std::fill(m_geoCacheEntry->results.begin() + m_endSlice, m_geoCacheEntry->results.end(), Result{});
+        }
+
+        // If the geometry didn't fit, it's no use
+        m_geoCacheEntry->isValid = m_backend == Backend::cpu || m_geoCacheEntry->sliceStarts.back() <= m_geoCacheCapacity;
+        if (!m_geoCacheEntry->isValid) {
+            std::cerr << "Geometry cache overflow" << std::endl;
+        }
+        m_geoCacheEntry = nullptr;
+    }
+
+    // The geometry changed mid sweep, so render the remaining slices
+    void Simulator::abandonGeometryCache() {
+        // Drag and torque of the remaining slices were preloaded, and will now be recalculated
+        if (m_isGeoReplay && m_backend == Backend::gpu) {
+            vec4 zero;
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_resultsBuffer);
+            glClearBufferSubData(GL_SHADER_STORAGE_BUFFER, GL_RGBA32F, m_currentSlice * sizeof(Result), (m_sliceCount - m_currentSlice) * sizeof(Result), GL_RGBA, GL_FLOAT, &zero);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        }
+
+        m_geoCacheEntry = nullptr;
+        m_isGeoReplay = false;
+    }
+
+    // Fills the results buffer with the cached drag and torque
+    void Simulator::uploadCachedResults() {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_resultsBuffer);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, m_sliceCount * sizeof(Result), m_geoCacheEntry->results.data());
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+
+    // Everything the geometry pass of the current sweep depends on
+    GeometryKey Simulator::geometryKey() const {
+        GeometryKey key{ m_model, m_modelMat, m_normalMat, {}, m_windframeSize.x, m_windframeDepth, m_windSpeed, ivec2(m_firstSlice, m_endSlice), m_sliceDepths, m_isMirrored };
+        key.subModelMats.reserve(m_model->subModelCount());
+        for (const SubModel & subModel : m_model->subModels()) {
+            key.subModelMats.push_back(subModel.modelMat());
+        }
+        return key;
+    }
+
+    // Decides whether the sweep makes checkpoints, and which, if any, it can resume from. Called after `resetConstants`
+    void Simulator::beginCheckpoints() {
+        m_resumeCheckpoint = nullptr;
+        m_isCheckpointSweep = m_isCheckpointing && !m_doCloth && m_batchModelMats.empty() && m_tiles.size() == 1 && !m_level;
+        if (!m_isCheckpointSweep) {
+            return;
+        }
+
+        CheckpointKey key{
+            geometryKey(),
+            { m_turbulenceDist, m_maxSearchDist, m_windShadDist, m_backforceC, m_flowback, m_initVelC },
+            m_isExactDrag,
+            m_constants->subModelCount
+        };
+
+        // The last checkpoint before anything that moved
+        if (m_areCheckpointsValid && key.isCompatible(*m_checkpointKey)) {
+            int movedSlice(findFirstMovedSlice(key));
+            for (const unq<SweepCheckpoint> & checkpoint : m_checkpoints) {
+                if (checkpoint && checkpoint->slice <= movedSlice) m_resumeCheckpoint = checkpoint.get();
+            }
+        }
+
+        // Until the sweep finishes, the checkpoints are a mix of before and after
+        *m_checkpointKey = std::move(key);
+        m_areCheckpointsValid = false;
+    }
+
+    // Called after the last slice
+    void Simulator::endCheckpoints() {
+        m_areCheckpointsValid = m_isCheckpointSweep;
+        m_resumeCheckpoint = nullptr;
+    }
+
+    // Saves what the current slice starts from, if it's due a checkpoint. Called before the air pixel buffers swap
+    void Simulator::saveCheckpoint() {
+        int sliceI(m_currentSlice - m_firstSlice);
+        if (sliceI <= 0 || sliceI % m_checkpointInterval || (m_resumeCheckpoint && m_currentSlice == m_resumeCheckpoint->slice)) {
+            return;
+        }
+
+        size_t checkpointI(sliceI / m_checkpointInterval - 1);
+        if (m_checkpoints.size() <= checkpointI) {
+            m_checkpoints.resize(checkpointI + 1);
+        }
+        if (!m_checkpoints[checkpointI]) {
+            m_checkpoints[checkpointI].reset(new SweepCheckpoint{});
+        }
+        SweepCheckpoint & checkpoint(*m_checkpoints[checkpointI]);
+        checkpoint.slice = m_currentSlice;
+
+        if (m_backend == Backend::cpu) {
+            m_cpuBackend->saveCheckpoint(checkpoint);
+            return;
+        }
+
+        // Only the first layer is ever swept with checkpoints, whose pixels directly follow the counts
+        s64 airSize(pixelCountsSize(m_batchCapacity) + s64(m_maxAirPixels) * sizeof(StoredAirPixel));
+        s64 resultsSize(m_sliceCount * sizeof(Result));
+        s64 subModelResultsSize(s64(m_sliceCount) * m_constants->subModelCount * sizeof(Result));
+        s64 statsSize(m_sliceCount * sizeof(SliceStats));
+        s64 size(airSize + resultsSize + subModelResultsSize + statsSize);
+        if (size > checkpoint.bufferSize) {
+            glDeleteBuffers(1, &checkpoint.buffer);
+            glGenBuffers(1, &checkpoint.buffer);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, checkpoint.buffer);
+            glBufferStorage(GL_COPY_WRITE_BUFFER, size, nullptr, 0);
+            checkpoint.bufferSize = size;
+        }
+        if (!checkpoint.turbTex) {
+            u32 textures[2];
+            glGenTextures(2, textures);
+            for (u32 texture : textures) {
+                glBindTexture(GL_TEXTURE_2D, texture);
+                glTexStorage2D(GL_TEXTURE_2D, 1, GL_R8, m_texSize.x / 4, m_texSize.y / 4);
+            }
+            glBindTexture(GL_TEXTURE_2D, 0);
+            checkpoint.turbTex = textures[0];
+            checkpoint.shadTex = textures[1];
+        }
+
+        glBindBuffer(GL_COPY_WRITE_BUFFER, checkpoint.buffer);
+        glBindBuffer(GL_COPY_READ_BUFFER, m_airPixelsBuffer[m_swap]); // The one the previous slice wrote
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, airSize);
+        glBindBuffer(GL_COPY_READ_BUFFER, m_resultsBuffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, airSize, resultsSize);
+        if (subModelResultsSize) {
+            glBindBuffer(GL_COPY_READ_BUFFER, m_subModelResultsBuffer);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, airSize + resultsSize, subModelResultsSize);
+        }
+        glBindBuffer(GL_COPY_READ_BUFFER, m_statsBuffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, airSize + resultsSize + subModelResultsSize, statsSize);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        glCopyImageSubData(m_turbTex, GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, checkpoint.turbTex, GL_TEXTURE_2D, 0, 0, 0, 0, m_texSize.x / 4, m_texSize.y / 4, 1);
+        glCopyImageSubData(m_shadTex, GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, checkpoint.shadTex, GL_TEXTURE_2D, 0, 0, 0, 0, m_texSize.x / 4, m_texSize.y / 4, 1);
+    }
+
+    // Picks the sweep up where `m_resumeCheckpoint` left off. Called once the tile is reset
+    void Simulator::restoreCheckpoint() {
+        const SweepCheckpoint & checkpoint(*m_resumeCheckpoint);
+        m_currentSlice = checkpoint.slice;
+
+        if (m_backend == Backend::cpu) {
+            m_cpuBackend->restoreCheckpoint(checkpoint);
+            return;
+        }
+
+        s64 airSize(pixelCountsSize(m_batchCapacity) + s64(m_maxAirPixels) * sizeof(StoredAirPixel));
+        s64 resultsSize(m_sliceCount * sizeof(Result));
+        s64 subModelResultsSize(s64(m_sliceCount) * m_constants->subModelCount * sizeof(Result));
+        s64 statsSize(m_sliceCount * sizeof(SliceStats));
+        glBindBuffer(GL_COPY_READ_BUFFER, checkpoint.buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, m_airPixelsBuffer[m_swap]); // Where the slice will find the previous slice's
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, airSize);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, m_resultsBuffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, airSize, 0, resultsSize);
+        if (subModelResultsSize) {
+            glBindBuffer(GL_COPY_WRITE_BUFFER, m_subModelResultsBuffer);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, airSize + resultsSize, 0, subModelResultsSize);
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, m_statsBuffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, airSize + resultsSize + subModelResultsSize, 0, statsSize);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        // The slices from the checkpoint's on are swept again, and a replay sweep's checkpoint holds their cached drag
+        vec4 zero;
+        s64 sweptSize(s64(checkpoint.slice) * sizeof(Result));
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_resultsBuffer);
+        glClearBufferSubData(GL_SHADER_STORAGE_BUFFER, GL_RGBA32F, sweptSize, resultsSize - sweptSize, GL_RGBA, GL_FLOAT, &zero);
+        if (subModelResultsSize) {
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_subModelResultsBuffer);
+            glClearBufferSubData(GL_SHADER_STORAGE_BUFFER, GL_RGBA32F, sweptSize * m_constants->subModelCount, subModelResultsSize - sweptSize * m_constants->subModelCount, GL_RGBA, GL_FLOAT, &zero);
+        }
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        glCopyImageSubData(checkpoint.turbTex, GL_TEXTURE_2D, 0, 0, 0, 0, m_turbTex, GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, m_texSize.x / 4, m_texSize.y / 4, 1);
+        glCopyImageSubData(checkpoint.shadTex, GL_TEXTURE_2D, 0, 0, 0, 0, m_shadTex, GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, m_texSize.x / 4, m_texSize.y / 4, 1);
+    }
+
+    void Simulator::freeCheckpoints() {
+        if (m_backend == Backend::gpu) {
+            for (const unq<SweepCheckpoint> & checkpoint : m_checkpoints) {
+                if (!checkpoint) {
+                    continue;
+                }
+                // Zero names are silently ignored
+                u32 textures[]{ checkpoint->turbTex, checkpoint->shadTex };
+                glDeleteBuffers(1, &checkpoint->buffer);
+                glDeleteTextures(2, textures);
+            }
+        }
+        m_checkpoints.clear();
+        m_areCheckpointsValid = false;
+        m_isCheckpointSweep = false;
+        m_resumeCheckpoint = nullptr;
+    }
+
+    // Finds the first slice touched by any sub model whose matrix differs from that the checkpoints were made with,
+    // where it was or where it is. Returns the end slice if none do
+    int Simulator::findFirstMovedSlice(const CheckpointKey & key) const {
+        int firstSlice(m_endSlice);
+        const std::vector<SubModel> & subModels(m_model->subModels());
+        for (size_t subModelI(0); subModelI < subModels.size(); ++subModelI) {
+            const mat4 & prevMat(m_checkpointKey->geometry.subModelMats[subModelI]);
+            const mat4 & mat(key.geometry.subModelMats[subModelI]);
+            const HardMesh * mesh(dynamic_cast<const HardMesh *>(&subModels[subModelI].mesh()));
+            if (prevMat == mat || !mesh) {
+                continue;
+            }
+
+            // Wind moves in -z, so the first slice is at the front
+            float frontZ(-std::numeric_limits<float>::infinity());
+            for (const mat4 & subModelMat : { prevMat, mat }) {
+                mat4 combModelMat(m_modelMat * subModelMat);
+                for (const HardMesh::Vertex & vertex : mesh->vertices()) {
+                    frontZ = glm::max(frontZ, (combModelMat * vec4(vertex.position, 1.0f)).z);
+                }
+            }
+            firstSlice = glm::min(firstSlice, glm::max(sliceAt(m_windframeDepth * 0.5f - frontZ), 0));
+        }
+        return firstSlice;
+    }
+
+
+
+    bool Simulator::setup(
+        const ivec2 & texSize,
+        int sliceCount,
+        float liftC,
+        float dragC,
+        float turbulenceDist,
+        float maxSearchDist,
+        float windShadDist,
+        float backforceC,
+        float flowback,
+        float initVelC,
+        bool doSide,
+        bool doCloth,
+        Backend backend,
+        int batchCapacity
+    ) {
+        m_texSize = texSize;
+        m_maxGeoPixels = m_texSize.x * m_texSize.y / k_maxPixelsDivisor;
+        m_maxAirPixels = m_maxGeoPixels;
+        m_sliceCount = sliceCount;
+        m_batchCapacity = batchCapacity;
+        m_geoCacheCapacity = int(glm::min(s64(m_texSize.x) * m_texSize.y * m_sliceCount / k_geoCacheDivisor, s64(std::numeric_limits<s32>::max())));
+        m_liftC = liftC;
+        m_dragC = dragC;
+        setVariables(
+            turbulenceDist,
+            maxSearchDist,
+            windShadDist,
+            backforceC,
+            flowback,
+            initVelC
+        );
+        m_doSide = doSide;
+        m_doCloth = doCloth;
+        m_backend = backend;
+
+        m_results.resize(m_sliceCount);
+        m_stats.resize(m_sliceCount);
+        m_readbacks.resize(k_readbackCount);
+
+        if (m_backend == Backend::cpu) {
+            if (m_doCloth) {
+                std::cerr << "Cloth is not supported by the CPU backend" << std::endl;
+                return false;
+            }
+            m_cpuBackend.reset(new CPUBackend(m_texSize, m_maxGeoPixels, m_maxAirPixels, m_sliceCount));
+            m_cpuBackend->setExactDrag(m_isExactDrag);
+            return true;
+        }
+
+        if (m_batchCapacity < 1 || (m_doCloth && m_batchCapacity > 1)) {
+            std::cerr << "Invalid batch capacity" << std::endl;
+            return false;
+        }
+        m_batchResults.resize(m_batchCapacity * m_sliceCount);
+
+        // Packed pixels fit twice as many in the same memory
+        if (k_packPixels) {
+            if (m_texSize.x > k_maxPackedTexSize || m_texSize.y > k_maxPackedTexSize) {
+                std::cerr << "Texture too large to pack pixels" << std::endl;
+                return false;
+            }
+            m_maxGeoPixels = int(s64(m_maxGeoPixels) * s64(sizeof(GeoPixel)) / s64(sizeof(StoredGeoPixel)));
+            m_maxAirPixels = int(s64(m_maxAirPixels) * s64(sizeof(AirPixel)) / s64(sizeof(StoredAirPixel)));
+        }
+
+        // A flag is its epoch times one more than the largest index it could hold, plus that index
+        s64 flagStride(s64(m_batchCapacity) * std::max(m_maxGeoPixels, m_maxAirPixels) + 1);
+        m_flagEpochCount = int(std::numeric_limits<s32>::max() / flagStride);
+        if (m_flagEpochCount < 2) {
+            std::cerr << "Too many pixels to stamp flags with epochs" << std::endl;
+            return false;
+        }
+        m_flagEpoch = m_flagEpochCount; // So the first slice clears the flag texture, which starts undefined
+
+        if (!m_doCloth) {
+            for (int layer(0); layer < m_batchCapacity; ++layer) {
+                m_slabIndices.emplace_back(new SlabIndex());
+            }
+        }
+
+        int coreCount(0);
+        if (k_useAllCores) glGetIntegerv(GL_MAX_COMPUTE_WORK_GROUP_INVOCATIONS, &coreCount);
+        else coreCount = k_coresToUse;
+        int warpCount(coreCount / k_warpSize);
+        m_workGroupSize = warpCount * k_warpSize; // we want workgroups to be a warp multiple
+        // If doing 2D operations within 1D compute shaders, m_workGroupSize must instead defines as such
+        //m_workGroupSize2D.x = int(std::round(std::sqrt(float(warpCount))));
+        //m_workGroupSize2D.y = warpCount / m_workGroupSize2D.x;
+        //m_workGroupSize2D *= k_warpSize2D;
+        //m_workGroupSize = m_workGroupSize2D.x * m_workGroupSize2D.y; // match 1d group size to 2d so can use interchangeably in shaders
+
+        // `draw`, `outline`, and `move` are dispatched a row of work groups per layer, one per block of its pixels
+        int maxGroupCountX(0);
+        glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_COUNT, 0, &maxGroupCountX);
+        if ((s64(std::max(m_maxGeoPixels, m_maxAirPixels)) + m_workGroupSize - 1) / m_workGroupSize > maxGroupCountX) {
+            std::cerr << "Too many pixels to dispatch" << std::endl;
+            return false;
+        }
+
+        // Setup shaders
+        if (!setupShaders()) {
+            std::cerr << "Failed to setup shaders" << std::endl;
+            return false;
+        }
+
+        // Setup buffers
+        if (!setupBuffers()) {
+            std::cerr << "Failed to setup buffers" << std::endl;
+            return false;
+        }
+
+        // Setup textures
+        if (!setupTextures()) {
+            std::cerr << "Failed to setup textures" << std::endl;
+            return false;
+        }
+
+        // Setup framebuffer
+        if (!setupFramebuffer()) {
+            std::cerr << "Failed to setup framebuffer" << std::endl;
+            return false;
+        }
+
+        return true;
+    }
+
+    void Simulator::setVariables(float turbulenceDist, float maxSearchDist, float windShadDist, float backforceC, float flowback, float initVelC) {
+        m_turbulenceDist = turbulenceDist;
+        m_maxSearchDist = maxSearchDist;
+        m_windShadDist = windShadDist;
+        m_backforceC = backforceC;
+        m_flowback = flowback;
+        m_initVelC = initVelC;
+    }
+
+    void Simulator::set(
+        const Model & model,
+        const mat4 & modelMat,
+        const mat3 & normalMat,
+        float windframeWidth,
+        float windframeDepth,
+        float windSpeed,
+        bool debug,
+        bool symmetric
+    ) {
+        m_model = &model;
+        m_modelMat = modelMat;
+        m_normalMat = normalMat;
+        ivec2 texSize(effectiveTexSize());
+        m_windframeSize = vec2(windframeWidth, windframeWidth * float(texSize.y) / float(texSize.x));
+        m_windframeDepth = windframeDepth;
+        m_windSpeed = windSpeed;
+        m_debug = debug;
+        m_isSymmetric = symmetric;
+        // Progressive sweeps start over from the coarsest level
+        m_level = m_tileCount == ivec2(1) && !m_tileHalo ? m_levelCount - 1 : 0;
+        applyLevel();
+
+        if (m_currentSlice != 0 && m_geoCacheEntry) abandonGeometryCache();
+    }
+
+    void Simulator::setGeometryCaching(bool enable) {
+        m_isGeoCaching = enable;
+        if (!m_isGeoCaching) {
+            if (m_currentSlice != 0 && m_geoCacheEntry) abandonGeometryCache();
+            if (m_backend == Backend::gpu) {
+                for (const unq<GeometryCacheEntry> & entry : m_geoCache) {
+                    glDeleteBuffers(1, &entry->pixelsBuffer);
+                }
+            }
+            m_geoCache.clear();
+        }
+    }
+
+    void Simulator::setWindframeFitting(bool enable, float margin, float backMargin) {
+        m_isFitting = enable;
+        m_fitMargin = margin;
+        m_fitBackMargin = backMargin;
+    }
+
+    bool Simulator::setTiling(const ivec2 & tileCount, int halo) {
+        bool isTiled(tileCount != ivec2(1) || halo);
+        if (glm::any(glm::lessThan(tileCount, ivec2(1))) || halo < 0 || glm::any(glm::lessThanEqual(m_texSize - 2 * halo, ivec2(0))) || (m_doCloth && isTiled)) {
+            std::cerr << "Invalid tiling" << std::endl;
+            return false;
+        }
+
+        m_tileCount = tileCount;
+        m_tileHalo = halo;
+        return true;
+    }
+
+    bool Simulator::setExactDrag(bool enable) {
+        if (m_backend != Backend::cpu || !m_cpuBackend) {
+            std::cerr << "Exact drag is only supported by the CPU backend" << std::endl;
+            return false;
+        }
+
+        if (enable != m_isExactDrag) {
+            // Cached results were found the other way
+            bool isGeoCaching(m_isGeoCaching);
+            setGeometryCaching(false);
+            setGeometryCaching(isGeoCaching);
+        }
+        m_isExactDrag = enable;
+        m_cpuBackend->setExactDrag(enable);
+        return true;
+    }
+
+    bool Simulator::setSubModelAttribution(bool enable) {
+        if (m_doCloth) {
+            std::cerr << "Sub model attribution is not supported with cloth" << std::endl;
+            return false;
+        }
+
+        if (m_backend == Backend::gpu) setupIndexTexture(enable);
+        m_isAttributing = enable;
+        return true;
+    }
+
+    bool Simulator::setAdaptiveSlicing(bool enable) {
+        if (m_doCloth && enable) {
+            std::cerr << "Adaptive slicing is not supported with cloth" << std::endl;
+            return false;
+        }
+
+        m_isAdaptiveSlicing = enable;
+        return true;
+    }
+
+    bool Simulator::setProfiling(bool enable, int reportPeriod) {
+        if (enable && m_backend == Backend::cpu) {
+            std::cerr << "Profiling is only supported by the GPU backend" << std::endl;
+            return false;
+        }
+
+        m_profiler.reset(enable ? new GPUProfiler(reportPeriod) : nullptr);
+        return true;
+    }
+
+    // Checkpoints are for when only some sub models' local transforms change between sweeps, as when deflecting control
+    // surfaces. Each holds the air, turbulence, wind shadow, and results so far. Nothing upstream of the first slice the
+    // moved sub models touch, where they were or where they are, can differ, so the sweep resumes from the last
+    // checkpoint before it. Anything else changing starts the sweep from the beginning. A resumed sweep's first `step`
+    // does the checkpoint's slice, and doesn't use the geometry cache. Not used with tiling, batches, or cloth
+    bool Simulator::setCheckpointing(bool enable, int interval) {
+        if (enable && interval < 1) {
+            std::cerr << "Invalid checkpoint interval" << std::endl;
+            return false;
+        }
+
+        if (!enable || interval != m_checkpointInterval) {
+            freeCheckpoints();
+        }
+        m_isCheckpointing = enable;
+        m_checkpointInterval = interval;
+        return true;
+    }
+
+    // The first sweep after `set` halves the texture size and slice count `levelCount - 1` times, using only a corner of
+    // the textures, and each sweep after is at the next finer level until full resolution. `step` returns true as each
+    // level finishes. Each coarse slice's results are spread evenly over the slices it covers. Not used with tiling.
+    // Geometry caching and checkpoints are only used at full resolution, and `sweepBatch` goes straight to it
+    bool Simulator::setProgressive(int levelCount) {
+        if (levelCount < 1 || levelCount > 8) {
+            std::cerr << "Invalid level count" << std::endl;
+            return false;
+        }
+        if (m_doCloth && levelCount > 1) {
+            std::cerr << "Progressive sweeps are not supported with cloth" << std::endl;
+            return false;
+        }
+        int factor(1 << (levelCount - 1));
+        if (m_sliceCount % factor || m_texSize.x % factor || m_texSize.y % factor) {
+            std::cerr << "Texture size and slice count must be divisible by " << factor << std::endl;
+            return false;
+        }
+
+        m_levelCount = levelCount;
+        return true;
+    }
+
+    // Sizes the slices for the current level of detail and fits the windframe to them
+    void Simulator::applyLevel() {
+        m_sliceSize = m_windframeDepth / float(m_sliceCount >> m_level);
+        m_dt = m_sliceSize / m_windSpeed;
+        fitWindframe();
+    }
+
+    // Spreads the results of a sweep below full resolution, held by the first of the slices, evenly over the slices
+    // each covers. `stride` is the number of results per slice
+    void Simulator::spreadResults(Result * results, int stride, int level) const {
+        int factor(1 << level);
+        float share(1.0f / float(factor));
+        // From the back, so no coarse slice is overwritten before it's spread
+        for (int slice((m_sliceCount >> level) - 1); slice >= 0; --slice) {
+            for (int i(0); i < stride; ++i) {
+                Result result(results[slice * stride + i]);
+                result.lift *= share;
+                result.drag *= share;
+                result.torq *= share;
+                for (int fineSlice(slice * factor + factor - 1); fineSlice >= slice * factor; --fineSlice) {
+                    results[fineSlice * stride + i] = result;
+                }
+            }
+        }
+    }
+
+    // Fits the windframe width and slice range to the wind space bounds of the model in each orientation being swept,
+    // and finds the tiles the model touches and whether it can be mirrored
+    void Simulator::fitWindframe() {
+        int sliceCount(m_sliceCount >> m_level);
+        // When mirrored, only the half of the windframe at x >= 0 is simulated, at the same pixel size, for about half the
+        // cost. The plane of symmetry reflects air and the searches for it, as the mirror image of the other half would,
+        // and the results are those of the whole model other than the geo and air counts. The meshes must be their own
+        // mirror images across model x = 0, which is taken on trust, but the model as placed is checked, so deflected
+        // control surfaces or a model turned across the plane are simulated whole. Tiling and cloth aren't mirrored
+        m_isMirrored = m_isSymmetric && !m_doCloth && !m_isAttributing && m_tileCount == ivec2(1) && !m_tileHalo && (m_texSize.x >> m_level) >= 2 && isMirrorSymmetric();
+        m_firstSlice = 0;
+        m_endSlice = sliceCount;
+        m_sliceDepths.clear();
+        m_tiles.resize(m_tileCount.x * m_tileCount.y);
+        for (int tileI(0); tileI < int(m_tiles.size()); ++tileI) m_tiles[tileI] = tileI;
+        bool isTiled(m_tiles.size() > 1);
+        if ((!m_isFitting && !isTiled && !m_isAdaptiveSlicing) || m_doCloth) {
+            return;
+        }
+
+        vec3 minPos, maxPos;
+        if (!findWindBounds(minPos, maxPos)) {
+            return;
+        }
+        ivec2 texSize(effectiveTexSize());
+
+        if (m_isFitting) {
+            // The windframe stays centered on the origin, about which torque is found, and keeps the textures' aspect ratio
+            vec2 size(2.0f * (glm::max(-vec2(minPos), vec2(maxPos)) + m_fitMargin));
+            float aspect(float(texSize.x) / float(texSize.y));
+            m_windframeSize = vec2(glm::max(size.x, size.y * aspect), glm::max(size.x / aspect, size.y));
+
+            // Wind moves in -z, so the first slice is at the front
+            float frontZ(m_windframeDepth * 0.5f);
+            m_firstSlice = glm::clamp(int(std::floor((frontZ - maxPos.z) / m_sliceSize)), 0, sliceCount - 1);
+            m_endSlice = glm::clamp(int(std::ceil((frontZ - minPos.z + m_fitBackMargin) / m_sliceSize)), m_firstSlice + 1, sliceCount);
+        }
+
+        // Every slice goes to the depth that would have been swept
+        if (m_isAdaptiveSlicing) {
+            scheduleSlices(float(m_firstSlice) * m_sliceSize, glm::min(float(m_endSlice) * m_sliceSize, m_windframeDepth));
+            m_firstSlice = 0;
+            m_endSlice = sliceCount;
+        }
+
+        if (isTiled) {
+            // Only the tiles whose textures, halo included, overlap the model
+            ivec2 core(m_texSize - 2 * m_tileHalo);
+            vec2 texMin((vec2(minPos) / m_windframeSize + 0.5f) * vec2(texSize));
+            vec2 texMax((vec2(maxPos) / m_windframeSize + 0.5f) * vec2(texSize));
+            m_tiles.clear();
+            for (int y(0); y < m_tileCount.y; ++y) {
+                for (int x(0); x < m_tileCount.x; ++x) {
+                    vec2 tileMin(ivec2(x, y) * core - m_tileHalo), tileMax(ivec2(x + 1, y + 1) * core + m_tileHalo);
+                    if (glm::all(glm::lessThan(tileMin, texMax)) && glm::all(glm::greaterThan(tileMax, texMin))) {
+                        m_tiles.push_back(y * m_tileCount.x + x);
+                    }
+                }
+            }
+            if (m_tiles.empty()) {
+                m_tiles.push_back(0);
+            }
+            m_currentTile = glm::min(m_currentTile, int(m_tiles.size()) - 1); // In case this is mid sweep
+        }
+    }
+
+    // Spaces the slices of the current level between the given distances from the front of the windframe, closer together
+    // where the model's cross section changes more. Each triangle's area facing the wind is how much it changes the
+    // cross section, spread over the triangle's depth. The spacing is found at full resolution, of which each coarser
+    // level keeps every other boundary, so the levels' slices nest
+    void Simulator::scheduleSlices(float front, float back) {
+        int binCount(m_sliceCount * k_scheduleBinsPerSlice);
+        float binSize((back - front) / float(binCount));
+        float frontZ(m_windframeDepth * 0.5f - front);
+        std::vector<float> weights(binCount, 0.0f);
+        std::vector<vec3> positions;
+        auto addWeights([&](const mat4 & modelMat) {
+            for (const SubModel & subModel : m_model->subModels()) {
+                const HardMesh * mesh(dynamic_cast<const HardMesh *>(&subModel.mesh()));
+                if (!mesh) {
+                    continue;
+                }
+                mat4 combModelMat(modelMat * subModel.modelMat());
+                positions.clear();
+                for (const HardMesh::Vertex & vertex : mesh->vertices()) {
+                    positions.push_back(vec3(combModelMat * vec4(vertex.position, 1.0f)));
+                }
+                const std::vector<u32> & indices(mesh->indices());
+                int triCount((indices.size() ? int(indices.size()) : int(positions.size())) / 3);
+                for (int triI(0); triI < triCount; ++triI) {
+                    const vec3 & p0(positions[indices.size() ? indices[triI * 3 + 0] : triI * 3 + 0]);
+                    const vec3 & p1(positions[indices.size() ? indices[triI * 3 + 1] : triI * 3 + 1]);
+                    const vec3 & p2(positions[indices.size() ? indices[triI * 3 + 2] : triI * 3 + 2]);
+                    float area(0.5f * glm::abs(glm::cross(p1 - p0, p2 - p0).z));
+                    float minBin((frontZ - glm::max(p0.z, glm::max(p1.z, p2.z))) / binSize);
+                    float maxBin((frontZ - glm::min(p0.z, glm::min(p1.z, p2.z))) / binSize);
+                    if (area == 0.0f || maxBin < 0.0f || minBin >= float(binCount)) {
+                        continue;
+                    }
+                    // Each bin gets the part of the area within its depth
+                    float density(area / glm::max(maxBin - minBin, 1.0e-6f));
+                    int firstBin(glm::max(int(minBin), 0)), lastBin(glm::min(int(maxBin), binCount - 1));
+                    for (int bin(firstBin); bin <= lastBin; ++bin) {
+                        weights[bin] += density * (glm::min(maxBin, float(bin + 1)) - glm::max(minBin, float(bin)));
+                    }
+                }
+            }
+        });
+        if (m_batchModelMats.empty()) {
+            addWeights(m_modelMat);
+        }
+        else {
+            for (const mat4 & modelMat : m_batchModelMats) addWeights(modelMat);
+        }
+
+        // The even share also keeps any stretch the model doesn't change from going without slices
+        float total(0.0f);
+        for (float weight : weights) total += weight;
+        float evenWeight(total > 0.0f ? total * k_evenSpacingShare / (1.0f - k_evenSpacingShare) / float(binCount) : 1.0f);
+        total += evenWeight * float(binCount);
+
+        // Each slice gets an equal share of the weight
+        std::vector<float> depths(m_sliceCount + 1);
+        depths.front() = front;
+        depths.back() = back;
+        float sum(0.0f);
+        int bin(0);
+        for (int slice(1); slice < m_sliceCount; ++slice) {
+            float target(total * float(slice) / float(m_sliceCount));
+            while (bin < binCount - 1 && sum + weights[bin] + evenWeight < target) {
+                sum += weights[bin] + evenWeight;
+                ++bin;
+            }
+            float t(glm::clamp((target - sum) / (weights[bin] + evenWeight), 0.0f, 1.0f));
+            depths[slice] = glm::max(front + (float(bin) + t) * binSize, depths[slice - 1]);
+        }
+
+        m_sliceDepths.resize((m_sliceCount >> m_level) + 1);
+        for (size_t i(0); i < m_sliceDepths.size(); ++i) {
+            m_sliceDepths[i] = depths[i << m_level];
+        }
+    }
+
+    // The slice of the current level at the given distance from the front of the windframe, which may be out of range
+    int Simulator::sliceAt(float depth) const {
+        if (m_sliceDepths.empty()) {
+            return int(std::floor(depth / m_sliceSize));
+        }
+        return int(std::upper_bound(m_sliceDepths.begin(), m_sliceDepths.end() - 1, depth) - m_sliceDepths.begin()) - 1;
+    }
+
+    // Finds the wind space bounds of the model in each orientation being swept. Returns false if it has no hard meshes
+    bool Simulator::findWindBounds(vec3 & r_min, vec3 & r_max) const {
+        vec3 minPos(std::numeric_limits<float>::infinity()), maxPos(-std::numeric_limits<float>::infinity());
+        auto addBounds([&](const mat4 & modelMat) {
+            for (const SubModel & subModel : m_model->subModels()) {
+                const HardMesh * mesh(dynamic_cast<const HardMesh *>(&subModel.mesh()));
+                if (!mesh) {
+                    continue;
+                }
+                mat4 combModelMat(modelMat * subModel.modelMat());
+                for (const HardMesh::Vertex & vertex : mesh->vertices()) {
+                    vec3 pos(combModelMat * vec4(vertex.position, 1.0f));
+                    minPos = glm::min(minPos, pos);
+                    maxPos = glm::max(maxPos, pos);
+                }
+            }
+        });
+        if (m_batchModelMats.empty()) {
+            addBounds(m_modelMat);
+        }
+        else {
+            for (const mat4 & modelMat : m_batchModelMats) addBounds(modelMat);
+        }
+        if (minPos.x > maxPos.x) {
+            return false;
+        }
+
+        r_min = minPos;
+        r_max = maxPos;
+        return true;
+    }
+
+    // Whether the model, as placed in each orientation being swept, is its own mirror image across wind x = 0, given
+    // meshes that are their own across model x = 0. That holds if the model matrix is, and every sub model's matrix has
+    // its mirror image among the sub models
+    bool Simulator::isMirrorSymmetric() const {
+        if (m_batchModelMats.empty()) {
+            if (!isMirrorImage(m_modelMat, m_modelMat)) return false;
+        }
+        else {
+            for (const mat4 & modelMat : m_batchModelMats) {
+                if (!isMirrorImage(modelMat, modelMat)) return false;
+            }
+        }
+
+        const std::vector<SubModel> & subModels(m_model->subModels());
+        for (const SubModel & subModel : subModels) {
+            auto isMirror([&](const SubModel & other) { return isMirrorImage(subModel.modelMat(), other.modelMat()); });
+            if (std::none_of(subModels.begin(), subModels.end(), isMirror)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // The size of the texture the windframe would need were it not tiled
+    ivec2 Simulator::effectiveTexSize() const {
+        return m_tileCount * (m_texSize - 2 * m_tileHalo);
+    }
+
+    bool Simulator::step(bool isExternalCall) {
+        if (m_backend == Backend::cpu) {
+            return stepCPU();
+        }
+
+        if (m_profiler) m_profiler->beginSlice();
+
+        // Reset for new sweep. Each tile adds to the same results
+        if (m_currentSlice == 0 && m_currentTile == 0) {
+            resetConstants();
+            beginCheckpoints();
+            beginGeometryCache();
+            if (m_isGeoReplay) uploadCachedResults();
+            else clearResults();
+            if (m_constants->subModelCount) clearSubModelResults();
+            clearStats();
+            if (m_debug && m_doSide) clearSideTex();
+        }
+        // Reset for new tile
+        if (m_currentSlice == 0) {
+            resetTileConstants();
+            resetCounters(true);
+            clearTurbTex();
+            clearShadTex();
+            m_swap = 1;
+            m_currentSlice = m_firstSlice;
+            if (m_resumeCheckpoint) restoreCheckpoint();
+        }
+        if (m_isCheckpointSweep) saveCheckpoint();
+
+        m_swap = 1 - m_swap;
+
+        // Each slice stamps its flags and tiles with a new epoch, so they need only be cleared once the epochs run out
+        if (++m_flagEpoch >= m_flagEpochCount) {
+            clearFlagTex();
+            clearTileEpochs();
+            m_flagEpoch = 1;
+        }
+        m_constants->flagEpoch = m_flagEpoch;
+        // The front texture's epochs are fewer, and `pretty` overwrites its stamps with colors
+        if ((m_flagEpoch - 1) % k_frontEpochCount == 0 || m_isFrontPretty) {
+            clearFrontTex();
+            m_isFrontPretty = false;
+        }
+
+        resetSliceConstants();
+        uploadConstants();
+        resetCounters(false);
+
+        if (isExternalCall) setBindings();
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_airPixelsBuffer[m_swap]);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_airPixelsBuffer[1 - m_swap]);
+        if (m_geoCacheEntry) glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, m_geoCacheEntry->pixelsBuffer);
+
+        markStage(ProfileStage::setup);
+        if (m_isGeoReplay) {
+            computeScatter(); // Restore the fbo, wind shadow, and geo pixels from the cache
+            markStage(ProfileStage::scatter);
+        }
+        else {
+            if (m_geoCacheEntry) recordSliceStart();
+            renderGeometry(); // Render geometry to fbo
+            markStage(ProfileStage::geometry);
+            computeProspect(); // Scan fbo for edges and drag
+            markStage(ProfileStage::prospect);
+            computeCompact(); // Generate geo pixels in raster order, cast wind shadow, and sum drag
+            if (m_geoCacheEntry) recordSliceResult();
+            markStage(ProfileStage::compact);
+        }
+        if (k_doTurbulence) {
+            glCopyImageSubData(m_turbTex, GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, m_prevTurbTex, GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, m_texSize.x / 4, m_texSize.y / 4, m_batchSize); // copy turb tex to prev turb tex
+            markStage(ProfileStage::turbulenceCopy);
+        }
+        computeDraw(); // Draw any existing air pixels to the fbo and save their indices in the flag texture
+        markStage(ProfileStage::draw);
+        computeDistance(); // Find how far each pixel is clear of geometry, air, and turbulence, for the searches to skip
+        markStage(ProfileStage::distance);
+        computeOutline(); // Map air pixels to geometry, and generate new air pixels and draw them to the fbo
+        markStage(ProfileStage::outline);
+        computeMove(); // Calculate lift/drag and move any existing air pixels in relation to the geometry
+        markStage(ProfileStage::move);
+        if (m_debug) {
+            computePretty(); // transforms the contents of the fbo, turb, and shad textures into a comprehensible front and side view
+            m_isFrontPretty = true;
+            if (m_doSide) computeSide(); // Projects the front texture onto one column of the side texture
+            markStage(ProfileStage::debug);
+        }
+        Shader::unbind();
+
+        // The readback of the results at the end of a sweep is left out, as downloading them waits on everything before
+        if (m_profiler) m_profiler->endSlice(m_currentSlice + 1 >= m_endSlice && m_currentTile + 1 >= int(m_tiles.size()));
+
+        ++m_currentSlice;
+
+        // Was last slice
+        if (m_currentSlice >= m_endSlice) {
+            // Move on to the next tile
+            if (m_currentTile + 1 < int(m_tiles.size())) {
+                ++m_currentTile;
+                m_currentSlice = 0;
+                return false;
+            }
+
+            if (!m_doCloth) {
+                if (m_isAsyncSweep) queueResults();
+                else downloadResults();
+            }
+            endGeometryCache();
+            endCheckpoints();
+
+            // The next sweep refines this one
+            if (m_level) {
+                --m_level;
+                applyLevel();
+            }
+
+            m_currentSlice = 0;
+            m_currentTile = 0;
+            return true;
+        }
+
+        return false;
+    }
+
+    void Simulator::sweep() {
+        m_currentSlice = 0;
+        m_currentTile = 0;
+        if (m_backend == Backend::gpu) setBindings();
+        while (!step(false));
+    }
+
+    u64 Simulator::sweepAsync() {
+        if (m_doCloth) {
+            return 0;
+        }
+
+        // The CPU has finished by the time `sweep` returns, so the results are queued as they are
+        if (m_backend == Backend::cpu) {
+            sweep();
+            queueResults();
+            return m_lastTicket;
+        }
+
+        m_isAsyncSweep = true;
+        sweep();
+        m_isAsyncSweep = false;
+        return m_lastTicket;
+    }
+
+    bool Simulator::tryResult(u64 ticket) {
+        if (!ticket) {
+            return false;
+        }
+
+        for (ResultsReadback & readback : m_readbacks) {
+            if (readback.ticket != ticket) {
+                continue;
+            }
+
+            if (readback.fence) {
+                u32 status(glClientWaitSync(static_cast<GLsync>(readback.fence), 0, 0));
+                if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+                    return false;
+                }
+                glDeleteSync(static_cast<GLsync>(readback.fence));
+                readback.fence = nullptr;
+            }
+
+            std::copy_n(readback.results, m_sliceCount, m_results.begin());
+            if (readback.isMirrored) mirrorResults(m_results.data(), m_sliceCount);
+            if (m_backend == Backend::gpu && readback.level) spreadResults(m_results.data(), 1, readback.level);
+            m_resultLevel = readback.level;
+            m_stats.assign(readback.stats, readback.stats + (m_sliceCount >> readback.level));
+            sumResults();
+            return true;
+        }
+
+        // Never issued, or dropped
+        return false;
+    }
+
+    bool Simulator::stepFor(std::chrono::microseconds budget) {
+        using Clock = std::chrono::steady_clock;
+
+        if (m_backend == Backend::gpu) {
+            collectSliceTimers();
+
+            // Wait on the last sweep's results before beginning another
+            if (m_stepForTicket) {
+                if (!tryResult(m_stepForTicket)) {
+                    return false;
+                }
+                m_stepForTicket = 0;
+                return true;
+            }
+        }
+
+        // Time this call's slices on the GPU, unless every timer is still waiting on its time
+        SliceTimer * timer(nullptr);
+        if (m_backend == Backend::gpu) {
+            for (SliceTimer & idleTimer : m_sliceTimers) {
+                if (!idleTimer.sliceCount) {
+                    timer = &idleTimer;
+                    break;
+                }
+            }
+            if (!timer && int(m_sliceTimers.size()) < k_sliceTimerCount) {
+                m_sliceTimers.emplace_back();
+                timer = &m_sliceTimers.back();
+                glGenQueries(1, &timer->query);
+                timer->sliceCount = 0;
+            }
+            if (timer) glBeginQuery(GL_TIME_ELAPSED, timer->query);
+        }
+
+        const Clock::time_point start(Clock::now());
+        const float budgetUs(float(budget.count()));
+        float elapsedUs(0.0f);
+        int sliceCount(0);
+        bool isDone(false);
+        m_isAsyncSweep = m_backend == Backend::gpu;
+        while (true) {
+            isDone = step(sliceCount == 0);
+            ++sliceCount;
+
+            float prevElapsedUs(elapsedUs);
+            elapsedUs = std::chrono::duration<float, std::micro>(Clock::now() - start).count();
+            // The CPU's slices are done by the time `step` returns, so can be timed directly
+            if (m_backend == Backend::cpu) {
+                float cost(elapsedUs - prevElapsedUs);
+                m_sliceCost = m_sliceCost > 0.0f ? glm::mix(m_sliceCost, cost, k_sliceCostWeight) : cost;
+            }
+
+            // The GPU's time is predicted, but so long as issuing the slices takes longer still, that is the limit
+            if (isDone || m_sliceCost <= 0.0f) {
+                break;
+            }
+            float predictedUs(m_backend == Backend::cpu ? elapsedUs + m_sliceCost : glm::max(elapsedUs, float(sliceCount + 1) * m_sliceCost));
+            if (predictedUs > budgetUs) {
+                break;
+            }
+        }
+        m_isAsyncSweep = false;
+
+        if (timer) {
+            glEndQuery(GL_TIME_ELAPSED);
+            timer->sliceCount = sliceCount;
+        }
+
+        if (!isDone) {
+            return false;
+        }
+        // The CPU's results are in place as soon as the sweep finishes, as are the GPU's when there are none
+        if (m_backend == Backend::cpu || m_doCloth) {
+            return true;
+        }
+        m_stepForTicket = m_lastTicket;
+        if (!tryResult(m_stepForTicket)) {
+            return false;
+        }
+        m_stepForTicket = 0;
+        return true;
+    }
+
+    std::vector<Result> Simulator::sweepBatch(const std::vector<mat4> & modelMats, const std::vector<mat3> & normalMats) {
+        std::vector<Result> results;
+        results.reserve(modelMats.size());
+
+        bool debug(m_debug), isGeoCaching(m_isGeoCaching);
+        m_debug = false;
+
+        // Always at full resolution
+        if (m_level) {
+            m_level = 0;
+            applyLevel();
+        }
+
+        // No layers on the CPU, so each is swept in turn
+        if (m_backend == Backend::cpu) {
+            mat4 modelMat(m_modelMat);
+            mat3 normalMat(m_normalMat);
+            m_isGeoCaching = false; // Would only evict useful entries
+            for (size_t i(0); i < modelMats.size(); ++i) {
+                m_modelMat = modelMats[i];
+                m_normalMat = normalMats[i];
+                fitWindframe();
+                sweep();
+                results.push_back(m_result);
+            }
+            m_modelMat = modelMat;
+            m_normalMat = normalMat;
+            fitWindframe();
+            m_isGeoCaching = isGeoCaching;
+            m_debug = debug;
+            return results;
+        }
+
+        setBindings();
+        for (size_t first(0); first < modelMats.size(); first += m_batchCapacity) {
+            m_batchSize = int(glm::min(modelMats.size() - first, size_t(m_batchCapacity)));
+            m_batchModelMats.assign(modelMats.begin() + first, modelMats.begin() + first + m_batchSize);
+            m_batchNormalMats.assign(normalMats.begin() + first, normalMats.begin() + first + m_batchSize);
+            fitWindframe();
+
+            m_currentSlice = 0;
+            m_currentTile = 0;
+            while (!step(false));
+
+            for (int layer(0); layer < m_batchSize; ++layer) {
+                std::copy_n(m_batchResults.begin() + layer * m_sliceCount, m_sliceCount, m_results.begin());
+                sumResults();
+                results.push_back(m_result);
+            }
+        }
+        m_batchSize = 1;
+        m_batchModelMats.clear();
+        m_batchNormalMats.clear();
+        fitWindframe();
+        m_debug = debug;
+
+        return results;
+    }
+
+    void Simulator::reset() {
+        m_currentSlice = 0;
+        m_currentTile = 0;
+    }
+
+    int Simulator::slice() const {
+        return m_currentSlice;
+    }
+
+    int Simulator::tile() const {
+        return m_tiles[m_currentTile];
+    }
+
+    int Simulator::sliceCount() const {
+        return m_sliceCount;
+    }
+
+    int Simulator::level() const {
+        return m_resultLevel;
+    }
+
+    const Result & Simulator::result() const {
+        return m_result;
+    }
+
+    const std::vector<Result> & Simulator::results() const {
+        return m_results;
+    }
+
+    const std::vector<Result> & Simulator::subModelResults() const {
+        return m_subModelResults;
+    }
+
+    Result Simulator::subModelResult(int subModelI) const {
+        Result result{};
+        int subModelCount(m_sliceCount ? int(m_subModelResults.size()) / m_sliceCount : 0);
+        if (subModelI < 0 || subModelI >= subModelCount) {
+            return result;
+        }
+        for (int slice(0); slice < m_sliceCount; ++slice) {
+            const Result & sliceResult(m_subModelResults[slice * subModelCount + subModelI]);
+            result.lift += sliceResult.lift;
+            result.drag += sliceResult.drag;
+            result.torq += sliceResult.torq;
+        }
+        return result;
+    }
+
+    bool Simulator::overflowed() const {
+        return m_result.geoCount > m_maxGeoPixels || m_result.airCount > m_maxAirPixels;
+    }
+
+    const std::vector<SliceStats> & Simulator::stats() const {
+        return m_stats;
+    }
+
+    std::vector<StageProfile> Simulator::profile() const {
+        return m_profiler ? m_profiler->profile() : std::vector<StageProfile>();
+    }
+
+    std::string Simulator::profileReport() const {
+        return m_profiler ? m_profiler->report() : std::string();
+    }
+
+    bool Simulator::mirrored() const {
+        return m_isMirrored;
+    }
+
+    u32 Simulator::frontTex() const {
+        return m_frontLayerTex;
+    }
+
+    u32 Simulator::sideTex() const {
+        return m_sideTex;
+    }
+
+    u32 Simulator::turbulenceTex() const {
+        return m_turbLayerTex;
+    }
+
+    ivec2 Simulator::texSize() const {
+        return m_texSize;
+    }
+
+    vec2 Simulator::windframeSize() const {
+        return m_windframeSize;
+    }
+
+
+
+    SlabImages rasterizeSlab(const Model & model, const mat4 & modelMat, const mat3 & normalMat, const ivec2 & texSize, const vec2 & windframeSize, const vec2 & windframeCenter, float sliceZ, float sliceSize, int threadCount) {
+        Constants constants{};
+        constants.texSize = texSize;
+        constants.windframeSize = windframeSize;
+        constants.windframeCenter = windframeCenter;
+        constants.sliceSize = sliceSize;
+        constants.sliceZ = sliceZ;
+        constants.pixelSize = windframeSize.x / float(texSize.x);
+
+        CPUBackend backend(texSize, 0, 0, 1, threadCount); // Only the images are used
+        backend.rasterize(constants, model, modelMat, normalMat);
+
+        SlabImages images{ texSize, {}, {}, {} };
+        images.colors.reserve(backend.front().size());
+        for (const CPUBackend::FrontTexel & texel : backend.front()) {
+            images.colors.push_back(u32(texel.flags) | u32(texel.subX) << 8 | u32(texel.subY) << 16 | u32(texel._0) << 24);
+        }
+        images.normals = backend.norm();
+        images.indices = backend.index();
+        return images;
+    }
+
+    std::vector<SlabPolygon> crossSectionSlab(const Model & model, const mat4 & modelMat, const mat3 & normalMat, float sliceZ, float sliceSize, int threadCount) {
+        ThreadPool pool(threadCount);
+        SlabClipper clipper(pool);
+        clipper.clip(model, modelMat, normalMat, sliceZ, sliceZ - sliceSize);
+        return clipper.polygons();
+    }
+
+
+
+    // The default simulator used by the free functions
+    // Made on first use and never destroyed, as by static destruction the apps' GL contexts are gone, so its GL objects
+    // couldn't be deleted
+    static Simulator & defaultSimulator() {
+        static Simulator * s_simulator(new Simulator());
+        return *s_simulator;
+    }
+
+    bool setup(
+        const ivec2 & texSize,
+        int sliceCount,
+        float liftC,
+        float dragC,
+        float turbulenceDist,
+        float maxSearchDist,
+        float windShadDist,
+        float backforceC,
+        float flowback,
+        float initVelC,
+        bool doSide,
+        bool doCloth,
+        Backend backend,
+        int batchCapacity
+    ) {
+        return defaultSimulator().setup(texSize, sliceCount, liftC, dragC, turbulenceDist, maxSearchDist, windShadDist, backforceC, flowback, initVelC, doSide, doCloth, backend, batchCapacity);
+    }
+
+    void setVariables(float turbulenceDist, float maxSearchDist, float windShadDist, float backforceC, float flowback, float initVelC) {
+        defaultSimulator().setVariables(turbulenceDist, maxSearchDist, windShadDist, backforceC, flowback, initVelC);
+    }
+
+    void set(
+        const Model & model,
+        const mat4 & modelMat,
+        const mat3 & normalMat,
+        float windframeWidth,
+        float windframeDepth,
+        float windSpeed,
+        bool debug,
+        bool symmetric
+    ) {
+        defaultSimulator().set(model, modelMat, normalMat, windframeWidth, windframeDepth, windSpeed, debug, symmetric);
+    }
+
+    void setGeometryCaching(bool enable) {
+        defaultSimulator().setGeometryCaching(enable);
+    }
+
+    void setWindframeFitting(bool enable, float margin, float backMargin) {
+        defaultSimulator().setWindframeFitting(enable, margin, backMargin);
+    }
+
+    bool setTiling(const ivec2 & tileCount, int halo) {
+        return defaultSimulator().setTiling(tileCount, halo);
+    }
+
+    bool setExactDrag(bool enable) {
+        return defaultSimulator().setExactDrag(enable);
+    }
+
+    bool setSubModelAttribution(bool enable) {
+        return defaultSimulator().setSubModelAttribution(enable);
+    }
+
+    bool setCheckpointing(bool enable, int interval) {
+        return defaultSimulator().setCheckpointing(enable, interval);
+    }
+
+    bool setProgressive(int levelCount) {
+        return defaultSimulator().setProgressive(levelCount);
+    }
+
+    bool setAdaptiveSlicing(bool enable) {
+        return defaultSimulator().setAdaptiveSlicing(enable);
+    }
+
+    bool setProfiling(bool enable, int reportPeriod) {
+        return defaultSimulator().setProfiling(enable, reportPeriod);
+    }
+
+    bool step(bool isExternalCall) {
+        return defaultSimulator().step(isExternalCall);
+    }
+
+    void sweep() {
+        defaultSimulator().sweep();
+    }
+
+    u64 sweepAsync() {
+        return defaultSimulator().sweepAsync();
+    }
+
+    bool tryResult(u64 ticket) {
+        return defaultSimulator().tryResult(ticket);
+    }
+
+    bool stepFor(std::chrono::microseconds budget) {
+        return defaultSimulator().stepFor(budget);
+    }
+
+    std::vector<Result> sweepBatch(const std::vector<mat4> & modelMats, const std::vector<mat3> & normalMats) {
+        return defaultSimulator().sweepBatch(modelMats, normalMats);
+    }
+
+    void reset() {
+        defaultSimulator().reset();
+    }
+
+    int slice() {
+        return defaultSimulator().slice();
+    }
+
+    int tile() {
+        return defaultSimulator().tile();
+    }
+
+    int sliceCount() {
+        return defaultSimulator().sliceCount();
+    }
+
+    int level() {
+        return defaultSimulator().level();
+    }
+
+    const Result & result() {
+        return defaultSimulator().result();
+    }
+
+    const std::vector<Result> & results() {
+        return defaultSimulator().results();
+    }
+
+    const std::vector<Result> & subModelResults() {
+        return defaultSimulator().subModelResults();
+    }
+
+    Result subModelResult(int subModelI) {
+        return defaultSimulator().subModelResult(subModelI);
+    }
+
+    bool overflowed() {
+        return defaultSimulator().overflowed();
+    }
+
+    const std::vector<SliceStats> & stats() {
+        return defaultSimulator().stats();
+    }
+
+    std::vector<StageProfile> profile() {
+        return defaultSimulator().profile();
+    }
+
+    std::string profileReport() {
+        return defaultSimulator().profileReport();
+    }
+
+    bool mirrored() {
+        return defaultSimulator().mirrored();
+    }
+
+    u32 frontTex() {
+        return defaultSimulator().frontTex();
+    }
 
     u32 sideTex() {
-        return s_sideTex;
+        return defaultSimulator().sideTex();
     }
 
     u32 turbulenceTex() {
-        return s_turbTex;
+        return defaultSimulator().turbulenceTex();
     }
 
-    int texSize() {
-        return s_texSize;
+    ivec2 texSize() {
+        return defaultSimulator().texSize();
     }
 
+    vec2 windframeSize() {
+        return defaultSimulator().windframeSize();
+    }
 
 }
\ No newline at end of file
@@ -0,0 +1,100 @@
+#include "SlabClipper.hpp"
+
+#include "glm/glm.hpp"
+
+
+
+namespace rld {
+
+    SlabClipper::SlabClipper(ThreadPool & pool) :
+        m_pool(pool),
+        m_chunkPolygons(),
+        m_polygons()
+    {}
+
+    void SlabClipper::clip(const Model & model, const mat4 & modelMat, const mat3 & normalMat, float zNear, float zFar) {
+        m_polygons.clear();
+        for (int subModelI(0); subModelI < int(model.subModelCount()); ++subModelI) {
+            const SubModel & subModel(model.subModels()[subModelI]);
+            const HardMesh * mesh(dynamic_cast<const HardMesh *>(&subModel.mesh()));
+            if (!mesh) {
+                continue;
+            }
+            mat4 combModelMat(modelMat * subModel.modelMat());
+            mat3 combNormalMat(normalMat * subModel.normalMat());
+            const std::vector<HardMesh::Vertex> & vertices(mesh->vertices());
+            const std::vector<u32> & indices(mesh->indices());
+            int triCount(int(indices.size() ? indices.size() : vertices.size()) / 3);
+
+            int chunks(m_pool.chunkCount(triCount));
+            if (int(m_chunkPolygons.size()) < chunks) m_chunkPolygons.resize(chunks);
+            m_pool.parallelFor(triCount, [&](int begin, int end, int chunkI) {
+                std::vector<SlabPolygon> & polygons(m_chunkPolygons[chunkI]);
+                polygons.clear();
+                for (int triI(begin); triI < end; ++triI) {
+                    SlabVertex tri[3];
+                    bool isZeroNormal(true);
+                    for (int i(0); i < 3; ++i) {
+                        const HardMesh::Vertex & vertex(vertices[indices.size() ? indices[triI * 3 + i] : triI * 3 + i]);
+                        tri[i].pos = vec3(combModelMat * vec4(vertex.position, 1.0f));
+                        tri[i].norm = combNormalMat * vertex.normal;
+                        isZeroNormal = isZeroNormal && vertex.normal == vec3();
+                    }
+                    // Completely ignore any zero-normal geometry
+                    if (isZeroNormal) {
+                        continue;
+                    }
+                    // Entirely outside slab
+                    float minZ(glm::min(tri[0].pos.z, glm::min(tri[1].pos.z, tri[2].pos.z)));
+                    float maxZ(glm::max(tri[0].pos.z, glm::max(tri[1].pos.z, tri[2].pos.z)));
+                    if (minZ > zNear || maxZ < zFar) {
+                        continue;
+                    }
+
+                    SlabVertex temp[4];
+                    int tempClipEdges;
+                    SlabPolygon polygon;
+                    polygon.count = clipPolygon(tri, 3, 2, zNear, -1.0f, temp, 0, &tempClipEdges);
+                    polygon.count = clipPolygon(temp, polygon.count, 2, zFar, 1.0f, polygon.verts, tempClipEdges, &polygon.clipEdges);
+                    if (polygon.count < 2) {
+                        continue;
+                    }
+                    polygon.subModelI = subModelI;
+                    polygon.triI = triI;
+                    polygons.push_back(polygon);
+                }
+            });
+            // Concatenate in chunk order so the order doesn't depend on the threads
+            for (int chunkI(0); chunkI < chunks; ++chunkI) {
+                m_polygons.insert(m_polygons.end(), m_chunkPolygons[chunkI].begin(), m_chunkPolygons[chunkI].end());
+            }
+        }
+    }
+
+    int clipPolygon(const SlabVertex * in, int inCount, int axis, float plane, float side, SlabVertex * r_out, int clipEdges, int * r_clipEdges) {
+        int outCount(0);
+        int outClipEdges(0);
+        for (int i(0); i < inCount; ++i) {
+            const SlabVertex & v0(in[i]);
+            const SlabVertex & v1(in[(i + 1) % inCount]);
+            float d0(side * (v0.pos[axis] - plane)), d1(side * (v1.pos[axis] - plane));
+            int isClipEdge((clipEdges >> i) & 1);
+            if (d0 >= 0.0f) {
+                outClipEdges |= isClipEdge << outCount;
+                r_out[outCount++] = v0;
+            }
+            if ((d0 >= 0.0f) != (d1 >= 0.0f)) {
+                // Leaving, the edge to where the polygon comes back is along the plane
+                outClipEdges |= (d0 >= 0.0f ? 1 : isClipEdge) << outCount;
+                float t(d0 / (d0 - d1));
+                r_out[outCount].pos = glm::mix(v0.pos, v1.pos, t);
+                r_out[outCount].norm = glm::mix(v0.norm, v1.norm, t);
+                r_out[outCount].pos[axis] = plane; // Avoid floating point creep
+                ++outCount;
+            }
+        }
+        if (r_clipEdges) *r_clipEdges = outClipEdges;
+        return outCount;
+    }
+
+}
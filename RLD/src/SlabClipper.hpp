@@ -0,0 +1,50 @@
+#pragma once
+
+
+
+#include <vector>
+
+#include "Common/Global.hpp"
+#include "Common/Model.hpp"
+
+#include "RLD.hpp"
+#include "ThreadPool.hpp"
+
+
+
+namespace rld {
+
+    // Finds the exact cross section of a model's hard meshes with a slab of wind space
+    // Each triangle is transformed into wind space and clipped against the slab's two planes, leaving the polygons of
+    // the surface within it along with their interpolated normals. No rasterization is involved, so nothing is missed
+    // however thin, and the polygons can be rasterized or have their edges and areas used directly
+    class SlabClipper {
+
+        public:
+
+        explicit SlabClipper(ThreadPool & pool);
+        SlabClipper(const SlabClipper &) = delete;
+
+        SlabClipper & operator=(const SlabClipper &) = delete;
+
+        // Clips every triangle to the slab between wind z `zNear` and `zFar`, where `zNear` > `zFar`, across all threads
+        // The polygons are in sub model then triangle order, whatever the thread count
+        void clip(const Model & model, const mat4 & modelMat, const mat3 & normalMat, float zNear, float zFar);
+
+        const std::vector<SlabPolygon> & polygons() const { return m_polygons; }
+
+        private:
+
+        ThreadPool & m_pool;
+        std::vector<std::vector<SlabPolygon>> m_chunkPolygons; // Kept between slabs to avoid reallocation
+        std::vector<SlabPolygon> m_polygons;
+
+    };
+
+    // Clips the polygon against the plane where component `axis` of the position is `plane`, keeping the side where
+    // `side * (pos[axis] - plane) >= 0`. The output can have one more vertex than the input
+    // If `r_clipEdges` is given, it gets `clipEdges`'s bits for the output, as `SlabPolygon::clipEdges`
+    // Returns the number of output vertices
+    int clipPolygon(const SlabVertex * in, int inCount, int axis, float plane, float side, SlabVertex * r_out, int clipEdges = 0, int * r_clipEdges = nullptr);
+
+}
@@ -0,0 +1,183 @@
+#include "SlabIndex.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "glad/glad.h"
+
+
+
+namespace rld {
+
+    static constexpr float k_slabPadding(1.0e-3f); // Fraction of a slice by which each triangle's depth is extended, so rounding never drops one it touches
+
+
+
+    SlabIndex::SlabIndex() :
+        m_model(nullptr),
+        m_modelMat(),
+        m_subModelMats(),
+        m_windframeDepth(0.0f),
+        m_sliceCount(0),
+        m_sliceDepths(),
+        m_subIndices()
+    {}
+
+    SlabIndex::~SlabIndex() {
+        clear();
+    }
+
+    void SlabIndex::update(const Model & model, const mat4 & modelMat, float windframeDepth, int sliceCount, const std::vector<float> & sliceDepths) {
+        bool isSame(
+            m_model == &model &&
+            m_modelMat == modelMat &&
+            m_windframeDepth == windframeDepth &&
+            m_sliceCount == sliceCount &&
+            m_sliceDepths == sliceDepths &&
+            m_subModelMats.size() == model.subModelCount()
+        );
+        for (size_t i(0); isSame && i < m_subModelMats.size(); ++i) {
+            isSame = m_subModelMats[i] == model.subModels()[i].modelMat();
+        }
+        if (isSame) {
+            return;
+        }
+
+        m_model = &model;
+        m_modelMat = modelMat;
+        m_windframeDepth = windframeDepth;
+        m_sliceCount = sliceCount;
+        m_sliceDepths = sliceDepths;
+        m_subModelMats.clear();
+        for (const SubModel & subModel : model.subModels()) {
+            m_subModelMats.push_back(subModel.modelMat());
+        }
+
+        build();
+    }
+
+    void SlabIndex::build() {
+        clear();
+        m_subIndices.resize(m_model->subModelCount());
+
+        float sliceSize(m_windframeDepth / m_sliceCount); // On average, when spaced adaptively
+        float padding(sliceSize * k_slabPadding);
+        float top(m_windframeDepth * 0.5f); // Wind z of the front of the windframe
+        auto sliceAt([&](float depth) {
+            if (m_sliceDepths.empty()) return int(std::floor(depth / sliceSize));
+            return int(std::upper_bound(m_sliceDepths.begin(), m_sliceDepths.end() - 1, depth) - m_sliceDepths.begin()) - 1;
+        });
+        std::vector<ivec2> triSlices; // First and last slice of each triangle
+        std::vector<u32> indices;
+
+        for (size_t subI(0); subI < m_subIndices.size(); ++subI) {
+            const SubModel & subModel(m_model->subModels()[subI]);
+            const HardMesh * mesh(dynamic_cast<const HardMesh *>(&subModel.mesh()));
+            if (!mesh) {
+                continue;
+            }
+            SubIndex & subIndex(m_subIndices[subI]);
+
+            // Only the wind z of each vertex is needed
+            mat4 modelMat(m_modelMat * subModel.modelMat());
+            vec4 zRow(modelMat[0][2], modelMat[1][2], modelMat[2][2], modelMat[3][2]);
+            const std::vector<HardMesh::Vertex> & vertices(mesh->vertices());
+            const std::vector<u32> & meshIndices(mesh->indices());
+            int triCount((meshIndices.size() ? int(meshIndices.size()) : int(vertices.size())) / 3);
+
+            // Find the slices each triangle crosses and count the triangles of each slice
+            subIndex.sliceStarts.assign(m_sliceCount + 1, 0);
+            triSlices.resize(triCount);
+            for (int triI(0); triI < triCount; ++triI) {
+                float minZ(std::numeric_limits<float>::infinity()), maxZ(-std::numeric_limits<float>::infinity());
+                for (int i(0); i < 3; ++i) {
+                    const HardMesh::Vertex & vertex(vertices[meshIndices.size() ? meshIndices[triI * 3 + i] : triI * 3 + i]);
+                    float z(glm::dot(zRow, vec4(vertex.position, 1.0f)));
+                    minZ = glm::min(minZ, z);
+                    maxZ = glm::max(maxZ, z);
+                }
+                ivec2 & slices(triSlices[triI]);
+                slices.x = glm::max(sliceAt(top - maxZ - padding), 0);
+                slices.y = glm::min(sliceAt(top - minZ + padding), m_sliceCount - 1);
+                for (int slice(slices.x); slice <= slices.y; ++slice) {
+                    subIndex.sliceStarts[slice + 1] += 3;
+                }
+            }
+            for (int slice(0); slice < m_sliceCount; ++slice) {
+                subIndex.sliceStarts[slice + 1] += subIndex.sliceStarts[slice];
+            }
+
+            // Fill each slice's range
+            indices.resize(subIndex.sliceStarts.back());
+            std::vector<s32> fill(subIndex.sliceStarts.begin(), subIndex.sliceStarts.end() - 1);
+            for (int triI(0); triI < triCount; ++triI) {
+                const ivec2 & slices(triSlices[triI]);
+                for (int slice(slices.x); slice <= slices.y; ++slice) {
+                    for (int i(0); i < 3; ++i) {
+                        indices[fill[slice]++] = meshIndices.size() ? meshIndices[triI * 3 + i] : u32(triI * 3 + i);
+                    }
+                }
+            }
+            if (indices.empty()) {
+                continue;
+            }
+
+            // Index buffer
+            glGenBuffers(1, &subIndex.indexBuffer);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, subIndex.indexBuffer);
+            glBufferStorage(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(u32), indices.data(), 0);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+            // VAO, laid out as the mesh's own
+            glGenVertexArrays(1, &subIndex.vao);
+            glBindVertexArray(subIndex.vao);
+            glBindBuffer(GL_ARRAY_BUFFER, mesh->vertexBuffer());
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, subIndex.indexBuffer);
+            glEnableVertexAttribArray(0);
+            glEnableVertexAttribArray(1);
+            glVertexAttribPointer(0, 3, GL_FLOAT, false, sizeof(HardMesh::Vertex), reinterpret_cast<const void *>(           0));
+            glVertexAttribPointer(1, 3, GL_FLOAT, false, sizeof(HardMesh::Vertex), reinterpret_cast<const void *>(sizeof(vec4)));
+            glBindVertexArray(0);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        }
+    }
+
+    void SlabIndex::clear() {
+        for (const SubIndex & subIndex : m_subIndices) {
+            // Zero names are silently ignored
+            glDeleteVertexArrays(1, &subIndex.vao);
+            glDeleteBuffers(1, &subIndex.indexBuffer);
+        }
+        m_subIndices.clear();
+    }
+
+    void SlabIndex::draw(int slice, const mat4 & modelMat, const mat3 & normalMat, u32 modelMatUniformBinding, u32 normalMatUniformBinding, u32 subModelIUniformBinding) const {
+        for (size_t subI(0); subI < m_subIndices.size(); ++subI) {
+            const SubModel & subModel(m_model->subModels()[subI]);
+            const SubIndex & subIndex(m_subIndices[subI]);
+            bool isHard(!subIndex.sliceStarts.empty());
+            int start(isHard ? subIndex.sliceStarts[slice] : 0);
+            int count(isHard ? subIndex.sliceStarts[slice + 1] - start : 0);
+            if (isHard && !count) {
+                continue;
+            }
+
+            mat4 combModelMat(modelMat * subModel.modelMat());
+            mat3 combNormalMat(normalMat * subModel.normalMat());
+            glUniformMatrix4fv(modelMatUniformBinding, 1, GL_FALSE, reinterpret_cast<const float *>(&combModelMat));
+            glUniformMatrix3fv(normalMatUniformBinding, 1, GL_FALSE, reinterpret_cast<const float *>(&combNormalMat));
+            glUniform1i(subModelIUniformBinding, int(subI));
+            if (isHard) {
+                glBindVertexArray(subIndex.vao);
+                glDrawElements(GL_TRIANGLES, count, GL_UNSIGNED_INT, reinterpret_cast<const void *>(s64(start) * sizeof(u32)));
+                glBindVertexArray(0);
+            }
+            else {
+                subModel.mesh().draw();
+            }
+        }
+    }
+
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+
+
+#include <vector>
+
+#include "Common/Global.hpp"
+#include "Common/Model.hpp"
+
+
+
+namespace rld {
+
+    // The triangles of each hard sub model, binned by which slices of the windframe they cross
+    // Rendering a slice then only draws the triangles that can produce fragments within it, rather than the whole
+    // model. Soft sub models are always drawn whole, as their vertices only live on the GPU
+    class SlabIndex {
+
+        public:
+
+        SlabIndex();
+        SlabIndex(const SlabIndex &) = delete;
+        ~SlabIndex();
+
+        SlabIndex & operator=(const SlabIndex &) = delete;
+
+        // Rebinds the triangles if the model, its orientation, or the windframe has changed since last time
+        // `sliceDepths` is where each slice starts, from the front of the windframe, followed by where the last ends,
+        // or empty for evenly spaced slices
+        void update(const Model & model, const mat4 & modelMat, float windframeDepth, int sliceCount, const std::vector<float> & sliceDepths);
+
+        // Draws the triangles crossing the slice, as `Model::draw` would, also setting the index of each sub model drawn
+        void draw(int slice, const mat4 & modelMat, const mat3 & normalMat, u32 modelMatUniformBinding, u32 normalMatUniformBinding, u32 subModelIUniformBinding) const;
+
+        private:
+
+        struct SubIndex {
+            u32 indexBuffer; // Each slice's triangles, one after the other
+            u32 vao; // The mesh's vertex buffer with `indexBuffer`
+            std::vector<s32> sliceStarts; // Index of each slice's first index, followed by the total index count
+        };
+
+        void build();
+        void clear();
+
+        const Model * m_model;
+        mat4 m_modelMat;
+        std::vector<mat4> m_subModelMats;
+        float m_windframeDepth;
+        int m_sliceCount;
+        std::vector<float> m_sliceDepths;
+        std::vector<SubIndex> m_subIndices; // One per sub model. Zero handles for soft meshes
+
+    };
+
+}
@@ -0,0 +1,114 @@
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+
+
+
+namespace rld {
+
+    static constexpr int k_chunksPerThread(4); // More chunks than threads evens out uneven work
+
+
+
+    ThreadPool::ThreadPool(int threadCount) :
+        m_workers(),
+        m_mutex(),
+        m_startCV(),
+        m_doneCV(),
+        m_func(nullptr),
+        m_n(0),
+        m_chunkCount(0),
+        m_nextChunk(0),
+        m_activeWorkers(0),
+        m_generation(0),
+        m_shouldExit(false)
+    {
+        if (threadCount <= 0) threadCount = std::max(int(std::thread::hardware_concurrency()), 1);
+
+        // The calling thread also does work, so one less worker is needed
+        m_workers.reserve(threadCount - 1);
+        for (int i(1); i < threadCount; ++i) {
+            m_workers.emplace_back(&ThreadPool::work, this);
+        }
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_shouldExit = true;
+        }
+        m_startCV.notify_all();
+        for (std::thread & worker : m_workers) {
+            worker.join();
+        }
+    }
+
+    int ThreadPool::chunkCount(int n) const {
+        return std::min(n, threadCount() * k_chunksPerThread);
+    }
+
+    void ThreadPool::parallelFor(int n, const ChunkFunc & func) {
+        if (n <= 0) {
+            return;
+        }
+
+        // Not worth waking the workers
+        if (m_workers.empty() || n == 1) {
+            int chunks(chunkCount(n));
+            for (int chunkI(0); chunkI < chunks; ++chunkI) {
+                func(int(llong(n) * chunkI / chunks), int(llong(n) * (chunkI + 1) / chunks), chunkI);
+            }
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_func = &func;
+            m_n = n;
+            m_chunkCount = chunkCount(n);
+            m_nextChunk = 0;
+            m_activeWorkers = int(m_workers.size());
+            ++m_generation;
+        }
+        m_startCV.notify_all();
+
+        runChunks();
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_doneCV.wait(lock, [this]() { return m_activeWorkers == 0; });
+        m_func = nullptr;
+    }
+
+    void ThreadPool::work() {
+        u64 generation(0);
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_startCV.wait(lock, [this, generation]() { return m_shouldExit || m_generation != generation; });
+                if (m_shouldExit) {
+                    return;
+                }
+                generation = m_generation;
+            }
+
+            runChunks();
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                --m_activeWorkers;
+            }
+            m_doneCV.notify_one();
+        }
+    }
+
+    void ThreadPool::runChunks() {
+        while (true) {
+            int chunkI(m_nextChunk++);
+            if (chunkI >= m_chunkCount) {
+                return;
+            }
+            (*m_func)(int(llong(m_n) * chunkI / m_chunkCount), int(llong(m_n) * (chunkI + 1) / m_chunkCount), chunkI);
+        }
+    }
+
+}
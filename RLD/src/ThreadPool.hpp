@@ -0,0 +1,64 @@
+#pragma once
+
+
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+#include "Common/Global.hpp"
+
+
+
+namespace rld {
+
+    // A minimal persistent pool of worker threads for data parallel loops
+    class ThreadPool {
+
+        public:
+
+        // `func(begin, end, chunkI)` is called for each contiguous chunk of the range
+        using ChunkFunc = std::function<void(int, int, int)>;
+
+        // A thread count of zero will use as many threads as there are cores
+        explicit ThreadPool(int threadCount = 0);
+        ThreadPool(const ThreadPool &) = delete;
+        ~ThreadPool();
+
+        ThreadPool & operator=(const ThreadPool &) = delete;
+
+        // Number of threads working on each loop, including the calling thread
+        int threadCount() const { return int(m_workers.size()) + 1; }
+
+        // Number of chunks a range of `n` will be split into. Chunks are handed out in order, so results
+        // stored per chunk and then concatenated in chunk order are deterministic
+        int chunkCount(int n) const;
+
+        // Splits [0, n) into `chunkCount(n)` contiguous chunks and processes them across all threads.
+        // Blocks until every chunk is done
+        void parallelFor(int n, const ChunkFunc & func);
+
+        private:
+
+        void work();
+
+        void runChunks();
+
+        std::vector<std::thread> m_workers;
+        std::mutex m_mutex;
+        std::condition_variable m_startCV;
+        std::condition_variable m_doneCV;
+        const ChunkFunc * m_func;
+        int m_n;
+        int m_chunkCount;
+        std::atomic<int> m_nextChunk;
+        int m_activeWorkers;
+        u64 m_generation;
+        bool m_shouldExit;
+
+    };
+
+}
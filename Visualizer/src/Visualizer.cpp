@@ -61,10 +61,13 @@ enum class SimModel { airfoil, f18, sphere };
 
 static constexpr SimModel k_simModel(SimModel::f18);
 
-static const int k_simTexSize(1024);
+static const ivec2 k_simTexSize(1024, 1024);
 static const int k_simSliceCount(100);
 static const float k_simLiftC(1.0f);
 static const float k_simDragC(1.0f);
+static const int k_simBatchCapacity(8); // How many angles `doAllAngles` sweeps at once. Each costs around 25 MB at 1024
+static const int k_simSeekLevelCount(3); // Levels of detail sweeps go through when seeking, the coarsest being quick enough for every angle passed
+static const int k_simProfileReportPeriod(10); // Sweeps between the profiler's reports, when profiling
 
 static const ivec2 k_defWindowSize(1280, 720);
 
@@ -80,6 +83,7 @@ static const std::string & k_controlsString(
     "  ctrl-space  : toggle auto angle progression" "\n"
     "  f           : do fast sweep"                 "\n"
     "  shift-f     : do fast sweep of all angles"   "\n"
+    "  c           : compare cpu sweep to gpu's"    "\n"
     "  o or i      : change rudder angle"           "\n"
     "  k or j      : change elevator angle"         "\n"
     "  m or n      : change aileron angle"          "\n"
@@ -89,6 +93,7 @@ static const std::string & k_controlsString(
 
 
 static unq<Model> s_model;
+static unq<rld::Simulator> s_cpuSim; // For comparing the backends, made the first time they are
 static mat4 s_modelMat; // Particular to model, does not change
 static mat3 s_normalMat; // Particular to model, does not change
 static mat4 s_windModelMat; // Changes based on angle of attack
@@ -113,6 +118,8 @@ static bool s_shouldStep(false);
 static bool s_shouldSweep(true);
 static bool s_shouldAutoProgress(false);
 static bool s_shouldReset(false);
+static bool s_isRefining(false); // Whether the next sweep refines the last, coarser one rather than starting anew
+static bool s_isProfiling(false);
 static int s_seekDir(0);
 static float s_seekAngle(0.0f);
 static bool s_isInfoChange(true);
@@ -250,24 +257,47 @@ static void doFastSweep(float angleOfAttack) {
     glEnable(GL_BLEND);
 
     submitResults(angleOfAttack);
+    s_isRefining = rld::level() > 0;
 }
 
 static void doAllAngles() {
     results::clearSlices();
 
+    std::vector<float> angles;
+    std::vector<mat4> modelMats;
+    std::vector<mat3> normalMats;
+    for (float angle(0.0f); angle <= k_maxAutoAoA; angle += k_autoAngleIncrement) {
+        for (float signedAngle : { angle, -angle }) {
+            mat4 rotMat(glm::rotate(glm::radians(signedAngle), vec3(-1.0f, 0.0f, 0.0f)));
+            angles.push_back(signedAngle);
+            modelMats.push_back(rotMat * s_modelMat);
+            normalMats.push_back(mat3(rotMat) * s_normalMat);
+        }
+    }
+
+    setSimulation(angles.back(), false); // Leave the simulation at the last angle, as sweeping each would have
+
+    glDisable(GL_BLEND); // Can't have blending for simulation
+
     glFinish();
     double then(glfwGetTime());
 
-    int count(0);
-    for (float angle(0.0f); angle <= k_maxAutoAoA; angle += k_autoAngleIncrement) {
-        doFastSweep(angle);
-        doFastSweep(-angle);
-        count += 2;
-    }
+    std::vector<rld::Result> angleResults(rld::sweepBatch(modelMats, normalMats));
 
     glFinish();
     double dt(glfwGetTime() - then);
-    std::cout << "Average SPS: " << (double(count) / dt) << std::endl;
+
+    glEnable(GL_BLEND);
+
+    for (size_t i(0); i < angles.size(); ++i) {
+        results::submitAngle(angles[i], angleResults[i]);
+    }
+    for (int i(0); i < rld::sliceCount(); ++i) {
+        results::submitSlice(i, rld::results()[i]);
+    }
+    results::update();
+
+    std::cout << "Average SPS: " << (double(angles.size()) / dt) << std::endl;
 }
 
 void doAngle(float angle) {
@@ -305,11 +335,42 @@ void startSeeking(int dir) {
     s_shouldSweep = false;
     s_shouldAutoProgress = false;
     s_shouldReset = true;
+    rld::setProgressive(k_simSeekLevelCount);
 }
 
+static float relativeDiff(const vec3 & v, const vec3 & ref) {
+    return glm::length(v - ref) / glm::length(ref);
+}
+
+// Sweeps the angle on both backends and prints how far apart their results are
+static void compareBackends(float angleOfAttack) {
+    doFastSweep(angleOfAttack);
+    rld::Result gpuResult(rld::result());
+
+    if (!s_cpuSim) {
+        s_cpuSim.reset(new rld::Simulator());
+        if (!s_cpuSim->setup(k_simTexSize, k_simSliceCount, k_simLiftC, k_simDragC, s_turbulenceDist, s_maxSearchDist, s_windShadDist, s_backforceC, s_flowback, s_initVelC, false, false, rld::Backend::cpu)) {
+            std::cerr << "Failed to setup CPU simulation" << std::endl;
+            s_cpuSim.reset();
+            return;
+        }
+    }
+    s_cpuSim->setVariables(s_turbulenceDist, s_maxSearchDist, s_windShadDist, s_backforceC, s_flowback, s_initVelC);
+    s_cpuSim->set(*s_model, s_windModelMat, s_windNormalMat, s_windframeWidth, s_windframeDepth, s_windSpeed, false);
+    s_cpuSim->sweep();
+    rld::Result cpuResult(s_cpuSim->result());
+
+    std::cout << "Angle " << angleOfAttack << std::endl;
+    std::cout << "  GPU lift: " << gpuResult.lift.x << ", " << gpuResult.lift.y << ", " << gpuResult.lift.z << ", drag: " << gpuResult.drag.x << ", " << gpuResult.drag.y << ", " << gpuResult.drag.z << std::endl;
+    std::cout << "  CPU lift: " << cpuResult.lift.x << ", " << cpuResult.lift.y << ", " << cpuResult.lift.z << ", drag: " << cpuResult.drag.x << ", " << cpuResult.drag.y << ", " << cpuResult.drag.z << std::endl;
+    std::cout << "  Lift off by " << relativeDiff(cpuResult.lift, gpuResult.lift) * 100.0f << "%, drag by " << relativeDiff(cpuResult.drag, gpuResult.drag) * 100.0f << "%" << std::endl;
+}
+
+// The last angle's coarse sweep is refined to full resolution, and any sweep after is at full resolution from the start
 void stopSeeking() {
     s_seekDir = 0;
     s_shouldSweep = true;
+    rld::setProgressive(1);
 }
 
 void MainUIC::keyEvent(int key, int action, int mods) {
@@ -341,6 +402,12 @@ void MainUIC::keyEvent(int key, int action, int mods) {
             doAllAngles();
         }
     }
+    // If C is pressed, compare the backends
+    else if (key == GLFW_KEY_C && action == GLFW_PRESS && !mods) {
+        if (rld::slice() == 0 && !s_shouldAutoProgress && !s_seekDir) {
+            compareBackends(s_angleOfAttack);
+        }
+    }
     // If up arrow is pressed, increase angle of attack
     else if (key == GLFW_KEY_UP && (action == GLFW_PRESS || action == GLFW_REPEAT) && !mods) {
         if (rld::slice() == 0) {
@@ -401,6 +468,12 @@ void MainUIC::keyEvent(int key, int action, int mods) {
             changeAileronAngle(-k_manualAngleIncrement);
         }
     }
+    // If P key is pressed, toggle profiling the simulation
+    else if (key == GLFW_KEY_P && action == GLFW_PRESS && !mods) {
+        if (rld::setProfiling(!s_isProfiling, k_simProfileReportPeriod)) {
+            s_isProfiling = !s_isProfiling;
+        }
+    }
     // If equals key is pressed, reset UI stuff
     else if (key == GLFW_KEY_EQUAL && action == GLFW_PRESS && !mods) {
         s_frontTexViewer->center(vec2(0.5f));
@@ -476,9 +549,9 @@ static bool setupModel() {
 }
 
 static void setupUI() {
-    s_frontTexViewer.reset(new ui::TexViewer(rld::frontTex(), ivec2(rld::texSize()), ivec2(128)));
-    s_turbTexViewer.reset(new ui::TexViewer(rld::turbulenceTex(), ivec2(rld::texSize()) / 4, ivec2(128)));
-    s_sideTexViewer.reset(new ui::TexViewer(rld::sideTex(), ivec2(rld::texSize()), ivec2(128)));
+    s_frontTexViewer.reset(new ui::TexViewer(rld::frontTex(), rld::texSize(), ivec2(128)));
+    s_turbTexViewer.reset(new ui::TexViewer(rld::turbulenceTex(), rld::texSize() / 4, ivec2(128)));
+    s_sideTexViewer.reset(new ui::TexViewer(rld::sideTex(), rld::texSize(), ivec2(128)));
 
     shr<ui::HorizontalGroup> displayGroup(new ui::HorizontalGroup());
     displayGroup->add(s_frontTexViewer);
@@ -679,11 +752,14 @@ static bool setup() {
         s_flowback,
         s_initVelC,
         true,
-        false
+        false,
+        rld::Backend::gpu,
+        k_simBatchCapacity
     )) {
         std::cerr << "Failed to setup RLD" << std::endl;
         return false;
     }
+    rld::setGeometryCaching(true); // Most sweeps only change the variables
 
     // Setup results
     if (!results::setup(k_simSliceCount, s_angleGraphRange, s_sliceGraphRange)) {
@@ -762,6 +838,7 @@ static void update(float dt) {
     if (s_shouldReset) {
         rld::reset();
         s_shouldReset = false;
+        s_isRefining = false;
     }
 
     if (s_isVariableChange && rld::slice() == 0) {
@@ -770,34 +847,37 @@ static void update(float dt) {
     }
 
     if (s_seekDir) {
-        s_seekAngle += float(s_seekDir) * k_seekSpeed * dt;
-        if (s_seekAngle > 90.0f) {
-            s_seekAngle = 90.0f;
-            s_seekDir = 0;
-        }
-        else if (s_seekAngle < -90.0f) {
-            s_seekAngle = -90.0f;
-            s_seekDir = 0;
+        s_seekAngle = glm::clamp(s_seekAngle + float(s_seekDir) * k_seekSpeed * dt, -90.0f, 90.0f);
+
+        // A quick, coarse answer for each angle passed
+        float angle(nearestVal(s_seekAngle, k_manualAngleIncrement));
+        if (angle != s_angleOfAttack) {
+            setAngleOfAttack(angle);
+            doFastSweep(s_angleOfAttack);
         }
 
-        setAngleOfAttack(nearestVal(s_seekAngle, k_manualAngleIncrement));
+        if (glm::abs(s_seekAngle) >= 90.0f) {
+            stopSeeking();
+        }
     }
     else if (s_shouldStep || s_shouldSweep) {
         int slice(rld::slice());
 
         if (slice == 0) { // About to do first slice
-            setSimulation(s_angleOfAttack, true);
+            if (!s_isRefining) setSimulation(s_angleOfAttack, true);
             results::clearSlices();
         }
 
         glDisable(GL_BLEND); // can't have blending for simulation
 
         if (rld::step()) { // That was the last slice
-            s_shouldSweep = false;
+            // Until full resolution, each level is followed by the next
+            s_isRefining = rld::level() > 0;
+            s_shouldSweep = s_isRefining;
 
             submitResults(s_angleOfAttack);
 
-            if (s_shouldAutoProgress) {
+            if (s_shouldAutoProgress && !s_isRefining) {
                 s_angleOfAttack += k_autoAngleIncrement;
                 s_angleOfAttack = nearestVal(s_angleOfAttack, k_autoAngleIncrement);
                 if (s_angleOfAttack > k_maxAutoAoA) {
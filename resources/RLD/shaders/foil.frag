@@ -2,6 +2,8 @@
 
 // Types -----------------------------------------------------------------------
 
+#include "pixels.glsl"
+
 // Constants -------------------------------------------------------------------
 
 // External
@@ -10,6 +12,9 @@ const bool k_distinguishActivePixels = DISTINGUISH_ACTIVE_PIXELS; // Makes certa
 const bool k_doCloth = DO_CLOTH;
 
 const uint k_geoBit = 1, k_airBit = 2, k_activeBit = 4;
+const int k_tileSize = 8; // Must match `prospect`
+const int k_prospectArgsI = 9; // Where `prospect`'s work group count is in the dispatch buffer
+const int k_maxGroupCountX = 65535; // The least `GL_MAX_COMPUTE_WORK_GROUP_COUNT` may be. Must match `prospect`
 const float k_inactiveVal = k_distinguishActivePixels && k_debug ? 1.0f / 3.0f : 1.0f;
 
 // Inputs ----------------------------------------------------------------------
@@ -32,10 +37,13 @@ layout (binding = 7, rgba8) uniform restrict image2D u_sideImg;
 layout (binding = 0, std140) uniform Constants {
     int u_maxGeoPixels;
     int u_maxAirPixels;
-    int u_texSize;
+    ivec2 u_texSize;
+    vec2 u_windframeSize;
+    vec2 u_windframeCenter;
+    ivec2 u_coreMin;
+    ivec2 u_coreMax;
     float u_liftC;
     float u_dragC;
-    float u_windframeSize;
     float u_windframeDepth;
     float u_sliceSize;
     float u_turbulenceDist;
@@ -49,12 +57,50 @@ layout (binding = 0, std140) uniform Constants {
     int u_slice;
     float u_sliceZ;
     float u_pixelSize;
+    int u_isMirrored;
+    int u_subModelCount;
+    int u_flagEpoch;
+};
+
+// The x, y, and z work group counts of each stage dispatched indirectly
+layout (binding = 12, std430) restrict buffer Dispatch {
+    uint u_dispatchArgs[12];
+};
+
+// Each tile of each layer's epoch when it was last listed, so it's listed at most once a slice
+layout (binding = 14, std430) restrict buffer TileEpochs {
+    int u_tileEpochs[];
+};
+
+// Each tile of each layer with geometry in it, for `prospect`, in no particular order
+layout (binding = 15, std430) restrict buffer Tiles {
+    int u_tileCount;
+    int u_tiles[];
 };
 
+uniform int u_subModelI; // Which sub model is being drawn. Unused with cloth
+uniform int u_layer; // Which layer is being drawn to
+
 // Functions -------------------------------------------------------------------
 
+#include "front.glsl"
+
 vec2 windToTex(vec2 windPos) {
-    return (windPos / u_windframeSize + 0.5f) * float(u_texSize);
+    return ((windPos - u_windframeCenter) / u_windframeSize + 0.5f) * vec2(u_texSize);
+}
+
+// Lists the fragment's tile, if it's the first to land in it this slice
+void listTile() {
+    ivec2 tileCounts = (u_texSize + k_tileSize - 1) / k_tileSize;
+    ivec2 tile = ivec2(gl_FragCoord.xy) / k_tileSize;
+    int tileI = (u_layer * tileCounts.y + tile.y) * tileCounts.x + tile.x;
+    if (u_tileEpochs[tileI] != u_flagEpoch && atomicExchange(u_tileEpochs[tileI], u_flagEpoch) != u_flagEpoch) {
+        int listI = atomicAdd(u_tileCount, 1);
+        u_tiles[listI] = tileI;
+        // There may be more tiles than one row of work groups can hold, so they fill rows of `k_maxGroupCountX`
+        atomicMax(u_dispatchArgs[k_prospectArgsI + 0], uint(min(listI + 1, k_maxGroupCountX)));
+        atomicMax(u_dispatchArgs[k_prospectArgsI + 1], uint(listI / k_maxGroupCountX + 1));
+    }
 }
 
 void main() {
@@ -63,15 +109,18 @@ void main() {
         discard;
     }
 
+    listTile();
+
     vec3 norm = normalize(in_norm);
     if (k_doCloth && !gl_FrontFacing) norm = -norm; // the normal is always facing forward, extremely necessary
 
     // Using the g and b channels to store wind position
     vec2 subPixelPos = windToTex(in_pos.xy);
     subPixelPos -= gl_FragCoord.xy - 0.5f;
-    out_color = uvec4(k_geoBit, uvec2(round(subPixelPos * 255.0f)), 0);
-    out_norm = vec4(norm, 0.0f);
+    out_color = stampFront(uvec4(k_geoBit, uvec2(round(subPixelPos * 255.0f)), 0));
+    out_norm = encodeNormal(norm);
     if (k_doCloth) out_index = gl_PrimitiveID + 1; // TODO: if do tessellation, this will break
+    else out_index = u_subModelI + 1; // For attributing forces to sub models
 
     // Side View
     if (k_debug) {
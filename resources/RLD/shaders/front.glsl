@@ -0,0 +1,25 @@
+// The front image's texels are stamped with an epoch above the pixel bits of the red channel, so those left by earlier
+// slices read as empty without the image being cleared. Requires `u_flagEpoch`. Must match `k_frontEpochCount`
+
+const int k_frontEpochShift = 3; // Above `k_geoBit`, `k_airBit`, and `k_activeBit`
+const uint k_frontEpochCount = 31u; // As many as fit in the rest of the red channel, less 0 for cleared texels
+
+// The front epoch follows the flag epoch around a shorter cycle, the image being cleared each time it starts over
+uint frontEpoch() {
+    return uint(u_flagEpoch - 1) % k_frontEpochCount + 1u;
+}
+
+// As to be written to the front image
+uvec4 stampFront(uvec4 color) {
+    color.r |= frontEpoch() << k_frontEpochShift;
+    return color;
+}
+
+// As read from the front image, with the stamp removed, or empty if from another epoch
+uvec4 unstampFront(uvec4 color) {
+    if (color.r >> k_frontEpochShift != frontEpoch()) {
+        return uvec4(0);
+    }
+    color.r &= (1u << k_frontEpochShift) - 1u;
+    return color;
+}
@@ -0,0 +1,136 @@
+// The geo and air pixel layouts, shared by the shaders and `Internal.hpp`, so must stay valid C++ outside of the GLSL
+// only section at the end. Which layout the shaders store is chosen by `PACK_PIXELS`, which mirrors `k_packPixels`
+
+struct GeoPixel {
+    vec2 windPos;
+    ivec2 texCoord;
+    vec3 normal;
+    int edge; // 1 if is leading edge, 2 if is trailing edge, 3 if both. `k_spawnBit` is added if it should spawn air
+};
+
+struct AirPixel {
+    vec2 windPos;
+    vec2 velocity;
+    vec2 backforce;
+    vec2 turbulence; // x component is turbulence
+};
+
+// Half the size of `GeoPixel`. Texture coordinates must be less than 16384
+struct PackedGeoPixel {
+    vec2 windPos;
+    uint texCoordEdge; // x | y << 14 | edge << 28
+    uint normal; // Octahedral encoding of the normal as two snorm16s
+};
+
+// Half the size of `AirPixel`
+struct PackedAirPixel {
+    vec2 windPos;
+    uint velocity; // Two halfs, whose lowest bit is instead whether the air is turbulent
+    uint backforce; // Its direction as two snorm16s, as only that is read and halfs overflow
+};
+
+#ifndef __cplusplus
+
+const int k_packedEdgeShift = 28;
+const uint k_packedTurbulenceBit = 1u;
+
+// Maps the unit sphere onto the square [-1, 1], folding the lower hemisphere over the corners
+vec2 signNotZero(vec2 v) {
+    return vec2(v.x >= 0.0f ? 1.0f : -1.0f, v.y >= 0.0f ? 1.0f : -1.0f);
+}
+
+vec2 octEncode(vec3 n) {
+    vec2 p = n.xy / (abs(n.x) + abs(n.y) + abs(n.z));
+    return n.z < 0.0f ? (1.0f - abs(p.yx)) * signNotZero(p) : p;
+}
+
+vec3 octDecode(vec2 p) {
+    vec3 n = vec3(p, 1.0f - abs(p.x) - abs(p.y));
+    if (n.z < 0.0f) n.xy = (1.0f - abs(n.yx)) * signNotZero(n.xy);
+    return normalize(n);
+}
+
+#if PACK_PIXELS
+
+#define StoredGeoPixel PackedGeoPixel
+#define StoredAirPixel PackedAirPixel
+#define NORMAL_FORMAT rg16_snorm // The format of the normal texture
+
+// As written to the normal texture
+vec4 encodeNormal(vec3 n) {
+    return vec4(octEncode(n), 0.0f, 0.0f);
+}
+
+// As read from the normal texture
+vec3 decodeNormal(vec4 texel) {
+    return octDecode(texel.xy);
+}
+
+GeoPixel unpackGeoPixel(PackedGeoPixel pixel) {
+    return GeoPixel(
+        pixel.windPos,
+        ivec2(pixel.texCoordEdge & 0x3FFFu, (pixel.texCoordEdge >> 14) & 0x3FFFu),
+        octDecode(unpackSnorm2x16(pixel.normal)),
+        int(pixel.texCoordEdge >> k_packedEdgeShift)
+    );
+}
+
+PackedGeoPixel packGeoPixel(GeoPixel pixel) {
+    return PackedGeoPixel(
+        pixel.windPos,
+        uint(pixel.texCoord.x) | uint(pixel.texCoord.y) << 14 | uint(pixel.edge) << k_packedEdgeShift,
+        packSnorm2x16(octEncode(pixel.normal))
+    );
+}
+
+AirPixel unpackAirPixel(PackedAirPixel pixel) {
+    return AirPixel(
+        pixel.windPos,
+        unpackHalf2x16(pixel.velocity & ~k_packedTurbulenceBit),
+        unpackSnorm2x16(pixel.backforce),
+        vec2((pixel.velocity & k_packedTurbulenceBit) != 0u ? 1.0f : 0.0f, 0.0f)
+    );
+}
+
+PackedAirPixel packAirPixel(AirPixel pixel) {
+    uint velocity = packHalf2x16(pixel.velocity) & ~k_packedTurbulenceBit;
+    if (pixel.turbulence.x > 0.0f) velocity |= k_packedTurbulenceBit;
+    uint backforce = pixel.backforce != vec2(0.0f) ? packSnorm2x16(normalize(pixel.backforce)) : 0u;
+    return PackedAirPixel(pixel.windPos, velocity, backforce);
+}
+
+#else
+
+#define StoredGeoPixel GeoPixel
+#define StoredAirPixel AirPixel
+#define NORMAL_FORMAT rgba16_snorm // The format of the normal texture
+
+// As written to the normal texture
+vec4 encodeNormal(vec3 n) {
+    return vec4(n, 0.0f);
+}
+
+// As read from the normal texture
+vec3 decodeNormal(vec4 texel) {
+    return texel.xyz;
+}
+
+GeoPixel unpackGeoPixel(GeoPixel pixel) {
+    return pixel;
+}
+
+GeoPixel packGeoPixel(GeoPixel pixel) {
+    return pixel;
+}
+
+AirPixel unpackAirPixel(AirPixel pixel) {
+    return pixel;
+}
+
+AirPixel packAirPixel(AirPixel pixel) {
+    return pixel;
+}
+
+#endif
+
+#endif